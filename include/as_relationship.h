@@ -1,28 +1,45 @@
 #ifndef AS_RELATIONSHIP_H_soadifvhodkfasdgashgasgodfvjj
 #define AS_RELATIONSHIP_H_soadifvhodkfasdgashgasgodfvjj
 #include <igraph/igraph.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "cone.h"
+#include "graph.h"
 #include "hashtable.h"
 
 /**
  * This function read an as-rel dataset file provided by CAIDA and load its data into the graph
  * The format of the as-rel file is:
  * <as_num_1>|<as_num_2>|relationship
- * The graph will be initialized as a partially directed graph: it will have directed provider-to-customer edges
- * and undirected peer-to-peer edges.
- * Each vertex has a numeric attribute "label" that identify the as_number of the autonomous system.
- * Each edge has a numeric attribute "type" that identify if the edge is a provider-to-customer edge (-1) or a peer-to-peer edge (0).
- * N.B. In the main program it must be set the igraph attribute table with the following line:
- * igraph_i_set_attribute_table(&igraph_cattribute_table). 
- * Without it this function can’t set the attributes of the graph.
+ * The graph is stored as a compact CSR topology (see graph.h): every vertex stores its providers,
+ * customers and peers together with the relationship as seen from the vertex itself, and
+ * graph->labels stores the as_number of each vertex.
+ * If an igraph object is needed, the graph can be exported with cga_graph_to_igraph().
  * To reference the vertex id in the graph with its as_number, this function store in the hashtable ht the association <as_number, vertex_id>.
+ * The file is mapped in memory (or read in a buffer, if it is not a regular file) from the current
+ * position of the stream, split in newline aligned chunks and parsed by a thread per chunk (one
+ * for each available processor, with chunks of at least 1MB). Lines that don't follow the format
+ * are skipped, and their number is printed in stderr.
  * If the given file has no read privileges, this function abort the program with an error printed in stderr.
  * 
  * Arguments:
- * graph: pointer to an uninitialized graph object
+ * graph: pointer to an uninitialized graph object. It should be destroyed with cga_graph_destroy()
  * ht: pointer to an already initialized hashtable. It will be used to store the assotiation <as_number, vertex_id>
  * instream: pointer to a stream. It needs read privilege
  */
-void cga_load_snapshot(igraph_t *graph, cga_hashtable_t *ht, FILE *instream);
+void cga_load_snapshot(cga_graph_t *graph, cga_hashtable_t *ht, FILE *instream);
+
+/**
+ * Same as cga_load_snapshot, parsing the file with at most nthreads threads.
+ * 
+ * Arguments:
+ * graph: pointer to an uninitialized graph object. It should be destroyed with cga_graph_destroy()
+ * ht: pointer to an already initialized hashtable. It will be used to store the assotiation <as_number, vertex_id>
+ * instream: pointer to a stream. It needs read privilege
+ * nthreads: the maximum number of threads used to parse the file
+ */
+void cga_load_snapshot_parallel(cga_graph_t *graph, cga_hashtable_t *ht, FILE *instream, unsigned int nthreads);
 
 /**
  * This function evaluates if path is a valley free path.
@@ -36,7 +53,206 @@ void cga_load_snapshot(igraph_t *graph, cga_hashtable_t *ht, FILE *instream);
  * 
  * Returns 1 if the path is a valley free path, 0 otherwise
  */
-int cga_is_valley_free(igraph_t *graph, igraph_vector_int_t *path);
+int cga_is_valley_free(cga_graph_t *graph, igraph_vector_int_t *path);
+
+/**
+ * Read-only view of a path given to a cga_path_visitor_t.
+ * vertices points to the vertex_ids of the path, from the starting vertex to the last one, and it
+ * is only valid during the call of the visitor: the search reuses its memory for the next paths.
+ * 
+ * Fields:
+ * vertices: The vertex_ids of the path, length + 1 elements
+ * length: The number of hops of the path
+ * cost: The algebraic sum of the relationships of the hops (see cga_path_cost)
+ * state: The state of the valley free automaton at the last vertex (see cga_vf_state),
+ *        -1 if the path is not valley free
+ */
+typedef struct _cga_path_view {
+    const igraph_integer_t *vertices;
+    long length;
+    int cost;
+    int state;
+} cga_path_view_t;
+
+/**
+ * Function called by the path searches for each path found, instead of storing all the paths in
+ * a vector: the memory used by a search is bounded by the length of the paths, and the visitor can
+ * aggregate or print each path as soon as it is found.
+ * 
+ * Arguments:
+ * graph: Pointer to the graph object
+ * path: Pointer to the view of the path found
+ * arg: The argument given to the search function
+ * 
+ * Returns 0 to continue the search, any other value to stop it
+ */
+typedef int (*cga_path_visitor_t)(cga_graph_t *graph, const cga_path_view_t *path, void *arg);
+
+/**
+ * Results of the path searches: the search explored all the paths, it has been stopped by the
+ * visitor, or it has been cut by the limits (see cga_dfs_limits_t) and some paths may be missing.
+ */
+#define CGA_DFS_DONE 0
+#define CGA_DFS_STOPPED 1
+#define CGA_DFS_TRUNCATED 2
+
+/**
+ * Limits of a path search, to bound the running time of a search between well connected ASes.
+ * A zero field means no limit.
+ * 
+ * Fields:
+ * max_hops: The maximum length of the paths. Longer paths are not explored
+ * budget: The maximum number of expansions (vertices added to the current path) of a single search.
+ *         When the budget is exhausted the search ends, keeping the paths found so far
+ */
+typedef struct _cga_dfs_limits {
+    long max_hops;
+    uint64_t budget;
+} cga_dfs_limits_t;
+
+/**
+ * Options of the searches of the paths between two nodes without a DFS context
+ * (cga_dfs_visit_rec_opts, cga_degree_freedom_visit_opts, cga_degree_freedom_path_opts).
+ * Initialize them with cga_search_opts_init, then set the fields to change.
+ * 
+ * Fields:
+ * cones: The customer cones of the graph (see cga_cones_init). If not NULL the valley free
+ *        search drops the downhill branches that can't reach the target: once a path has gone
+ *        downhill it can only follow provider-to-customer edges, so a branch entering the
+ *        downhill phase at a vertex whose customer cone doesn't contain the target has no
+ *        solutions. (The searches with a DFS context get the same pruning, and more, from the
+ *        table of cga_dfs_ctx_set_target.) Not used by the degree of freedom searches.
+ *        Default NULL
+ * limits: The limits of the search (see cga_dfs_limits_t). Default no limits
+ */
+typedef struct _cga_search_opts {
+    const cga_cones_t *cones;
+    cga_dfs_limits_t limits;
+} cga_search_opts_t;
+
+/**
+ * Sets the options to their default values, the ones used by the searches without options.
+ * 
+ * Arguments:
+ * opts: Pointer to the options
+ */
+void cga_search_opts_init(cga_search_opts_t *opts);
+
+/**
+ * Aggregated length and cost of the paths between two nodes, updated in O(1) for each path.
+ * Initialize it with cga_pair_stats_init, then add the paths with cga_pair_stats_add (or give
+ * cga_pair_stats_visitor to a path search).
+ * 
+ * Fields:
+ * count: The number of paths
+ * length_sum, length_min, length_max: Sum, minimum and maximum of the lengths of the paths
+ * cost_sum, cost_min, cost_max: Sum, minimum and maximum of the costs of the paths
+ */
+typedef struct _cga_pair_stats {
+    uint64_t count;
+    int64_t length_sum;
+    int length_min;
+    int length_max;
+    int64_t cost_sum;
+    int cost_min;
+    int cost_max;
+} cga_pair_stats_t;
+
+/**
+ * Resets the statistics to an empty set of paths.
+ * 
+ * Arguments:
+ * stats: Pointer to the statistics
+ */
+static inline void cga_pair_stats_init(cga_pair_stats_t *stats) {
+    stats->count = 0;
+    stats->length_sum = stats->cost_sum = 0;
+    stats->length_min = stats->cost_min = INT_MAX;
+    stats->length_max = stats->cost_max = INT_MIN;
+}
+
+/**
+ * Adds a path to the statistics.
+ * 
+ * Arguments:
+ * stats: Pointer to the statistics
+ * length: The number of hops of the path
+ * cost: The cost of the path
+ */
+static inline void cga_pair_stats_add(cga_pair_stats_t *stats, int length, int cost) {
+    stats->count++;
+    stats->length_sum += length;
+    if (length < stats->length_min) stats->length_min = length;
+    if (length > stats->length_max) stats->length_max = length;
+    stats->cost_sum += cost;
+    if (cost < stats->cost_min) stats->cost_min = cost;
+    if (cost > stats->cost_max) stats->cost_max = cost;
+}
+
+/**
+ * Adds all the paths aggregated in src to dst, e.g. to join the statistics of the same pair of
+ * nodes computed by different threads.
+ * 
+ * Arguments:
+ * dst: Pointer to the statistics to update
+ * src: Pointer to the statistics to add
+ */
+void cga_pair_stats_merge(cga_pair_stats_t *dst, const cga_pair_stats_t *src);
+
+/**
+ * cga_path_visitor_t that adds each path found to the cga_pair_stats_t given as arg, using the
+ * length and the cost carried by the search: no second pass over the path is needed.
+ * 
+ * Arguments:
+ * graph: Pointer to the graph object
+ * path: Pointer to the view of the path found
+ * arg: Pointer to the cga_pair_stats_t to update
+ * 
+ * Returns 0, so the search continues
+ */
+int cga_pair_stats_visitor(cga_graph_t *graph, const cga_path_view_t *path, void *arg);
+
+/**
+ * Valley free search between two nodes run by nthreads threads together, for the pairs with
+ * too many paths for a single core (e.g. between two tier-1 ASes). Each thread runs the
+ * iterative DFS of cga_dfs_ctx_visit_it on a subtree of the search; when a thread is idle, the
+ * busy ones give away the unexplored neighbors of their shallowest frame (a path prefix with
+ * its automaton state) as new subtrees, so the work keeps being split until the end.
+ * visitor is called by all the threads at the same time, each with its own argument: aggregate
+ * the paths per thread and merge the aggregates at the end (see cga_pair_stats_split).
+ * 
+ * Arguments:
+ * graph: Pointer to the graph object
+ * from: The starting vertex_id
+ * to: The ending vertex_id, or -1 to visit the valley free paths towards all vertices
+ * nthreads: The number of threads. It must be at least 1. The threads that can't be started
+ *           are left out (the search runs in the calling thread if none can)
+ * limits: Pointer to the limits of the search. If NULL the search is not limited. The budget
+ *         counts the expansions of all the threads together
+ * visitor: Function called for each path found, in arbitrary order. If it returns a nonzero
+ *          value the whole search stops
+ * args: Array of nthreads arguments, the thread i passes args[i] to visitor
+ * 
+ * Returns CGA_DFS_STOPPED if the search has been stopped by the visitor, CGA_DFS_TRUNCATED if
+ * some paths have been cut by the limits, CGA_DFS_DONE otherwise
+ */
+int cga_dfs_split_visit(cga_graph_t *graph, igraph_integer_t from, igraph_integer_t to, unsigned int nthreads, const cga_dfs_limits_t *limits, cga_path_visitor_t visitor, void **args);
+
+/**
+ * Aggregates the valley free paths between two nodes with cga_dfs_split_visit, merging the
+ * statistics of the threads.
+ * 
+ * Arguments:
+ * graph: Pointer to the graph object
+ * from: The starting vertex_id
+ * to: The ending vertex_id
+ * nthreads: The number of threads. It must be at least 1
+ * limits: Pointer to the limits of the search. If NULL the search is not limited
+ * stats: Pointer where the statistics of the paths are stored
+ * 
+ * Returns CGA_DFS_TRUNCATED if some paths have been cut by the limits, CGA_DFS_DONE otherwise
+ */
+int cga_pair_stats_split(cga_graph_t *graph, igraph_integer_t from, igraph_integer_t to, unsigned int nthreads, const cga_dfs_limits_t *limits, cga_pair_stats_t *stats);
 
 /**
  * Recursively search all the valley free paths between two nodes.
@@ -49,11 +265,45 @@ int cga_is_valley_free(igraph_t *graph, igraph_vector_int_t *path);
  * from: The starting vertex_id
  * to: The ending vertex_id
  */
-void cga_dfs_vfree_rec(igraph_t *graph, igraph_vector_int_t *res, igraph_integer_t from, igraph_integer_t to);
+void cga_dfs_vfree_rec(cga_graph_t *graph, igraph_vector_int_t *res, igraph_integer_t from, igraph_integer_t to);
+
+/**
+ * Same as cga_dfs_vfree_rec, calling visitor for each valley free path found instead of
+ * storing it.
+ * 
+ * Arguments:
+ * graph: Pointer to the graph object
+ * from: The starting vertex_id
+ * to: The ending vertex_id
+ * visitor: Function called for each path found, in arbitrary order
+ * arg: Argument passed to visitor
+ * 
+ * Returns 1 if the search has been stopped by the visitor, 0 otherwise
+ */
+int cga_dfs_visit_rec(cga_graph_t *graph, igraph_integer_t from, igraph_integer_t to, cga_path_visitor_t visitor, void *arg);
+
+/**
+ * Same as cga_dfs_visit_rec, with the given options (customer cones pruning and limits).
+ * 
+ * Arguments:
+ * graph: Pointer to the graph object
+ * from: The starting vertex_id
+ * to: The ending vertex_id
+ * visitor: Function called for each path found, in arbitrary order
+ * arg: Argument passed to visitor
+ * opts: Pointer to the options, initialized with cga_search_opts_init. If NULL the default
+ *       options are used
+ * 
+ * Returns CGA_DFS_STOPPED if the search has been stopped by the visitor, CGA_DFS_TRUNCATED if
+ * some paths have been cut by the limits, CGA_DFS_DONE otherwise
+ */
+int cga_dfs_visit_rec_opts(cga_graph_t *graph, igraph_integer_t from, igraph_integer_t to, cga_path_visitor_t visitor, void *arg, const cga_search_opts_t *opts);
 
 /**
  * Iteratively search all the valley free paths between two nodes.
  * The resulting paths are stored in res. All paths are separated by -1 markers.
+ * This function creates and destroys a DFS context at each call: to search the paths of many
+ * pairs of nodes use cga_dfs_ctx_vfree_it with a context created once.
  * 
  * Arguments:
  * graph: Pointer to the graph object
@@ -62,7 +312,165 @@ void cga_dfs_vfree_rec(igraph_t *graph, igraph_vector_int_t *res, igraph_integer
  * from: The starting vertex_id
  * to: The ending vertex_id
  */
-void cga_dfs_vfree_it(igraph_t *graph, igraph_vector_int_t *res, igraph_integer_t from, igraph_integer_t to);
+void cga_dfs_vfree_it(cga_graph_t *graph, igraph_vector_int_t *res, igraph_integer_t from, igraph_integer_t to);
+
+/**
+ * Context of the iterative valley free DFS, owning the adjacency view, the visited set and the
+ * stacks used by the search. Creating a context once per thread and reusing it for many searches
+ * avoids allocating and freeing these structures for each pair of nodes.
+ * A context must be used by one thread at a time.
+ */
+typedef struct _cga_dfs_ctx cga_dfs_ctx_t;
+
+/**
+ * Creates a DFS context for the given graph.
+ * Every context created by this function should be destroyed with cga_dfs_ctx_destroy().
+ * 
+ * Arguments:
+ * graph: Pointer to the graph object. It must outlive the context
+ * 
+ * Returns a pointer to the newly created context, NULL if there's not enough memory
+ */
+cga_dfs_ctx_t *cga_dfs_ctx_init(cga_graph_t *graph);
+
+/**
+ * Clears the state left by the last search in O(path length).
+ * The search functions reset the context by themselves before starting.
+ * 
+ * Arguments:
+ * ctx: Pointer to the DFS context
+ */
+void cga_dfs_ctx_reset(cga_dfs_ctx_t *ctx);
+
+/**
+ * Destroys a DFS context.
+ * 
+ * Arguments:
+ * ctx: Pointer to the (previously initialized) DFS context to destroy
+ */
+void cga_dfs_ctx_destroy(cga_dfs_ctx_t *ctx);
+
+/**
+ * Prepares the context for the searches towards the vertex to, computing with a reverse breadth
+ * first search over <vertex, valley free state> the combinations from which to can still be
+ * reached with a valley free path. The searches towards to use this table to cut immediately the
+ * branches that can't reach it (e.g. the ones going downhill into stub ASes).
+ * The table is kept until the target changes, so its O(V + E) cost is paid once for all the
+ * searches towards the same target: iterating the pairs target by target is the fastest order.
+ * The searches call this function by themselves, it is exposed to choose when to pay the cost.
+ * 
+ * Arguments:
+ * ctx: Pointer to the DFS context
+ * to: The target vertex_id
+ */
+void cga_dfs_ctx_set_target(cga_dfs_ctx_t *ctx, igraph_integer_t to);
+
+/**
+ * Tells if there's at least a valley free path between two nodes, in O(1) once the table of the
+ * target has been computed (see cga_dfs_ctx_set_target). Use it to skip the pairs without paths
+ * before starting a search.
+ * 
+ * Arguments:
+ * ctx: Pointer to the DFS context
+ * from: The starting vertex_id
+ * to: The ending vertex_id
+ * 
+ * Returns 1 if there's a valley free path from from to to, 0 otherwise
+ */
+int cga_dfs_ctx_reachable(cga_dfs_ctx_t *ctx, igraph_integer_t from, igraph_integer_t to);
+
+/**
+ * Tells if the current target of the context (see cga_dfs_ctx_set_target) can be reached with a
+ * valley free path from the vertex v, with the automaton in the given state. It only reads the
+ * table, so many threads can query the same context once the target has been set.
+ * 
+ * Arguments:
+ * ctx: Pointer to the DFS context, with a target set
+ * v: The vertex_id
+ * state: The state of the valley free automaton in v (0 or 1, see cga_vf_state)
+ * 
+ * Returns 1 if the target can be reached, 0 otherwise
+ */
+int cga_dfs_ctx_can_reach(const cga_dfs_ctx_t *ctx, igraph_integer_t v, int state);
+
+/**
+ * Sets the limits applied to all the following searches of the context.
+ * 
+ * Arguments:
+ * ctx: Pointer to the DFS context
+ * limits: Pointer to the limits, they are copied in the context. If NULL the searches are not limited
+ */
+void cga_dfs_ctx_set_limits(cga_dfs_ctx_t *ctx, const cga_dfs_limits_t *limits);
+
+/**
+ * Same as cga_dfs_vfree_it, using the given context.
+ * The branches that can't reach to are pruned with the table of cga_dfs_ctx_set_target.
+ * 
+ * Arguments:
+ * ctx: Pointer to the DFS context
+ * res: Initialized vector, all the resulting paths are stored here, separated by -1 markers.
+ *      The paths are included in arbitrary order, as they are found
+ * from: The starting vertex_id
+ * to: The ending vertex_id
+ */
+void cga_dfs_ctx_vfree_it(cga_dfs_ctx_t *ctx, igraph_vector_int_t *res, igraph_integer_t from, igraph_integer_t to);
+
+/**
+ * Same as cga_dfs_vfree_from, using the given context.
+ * 
+ * Arguments:
+ * ctx: Pointer to the DFS context
+ * res: Initialized vector, all the resulting paths are stored here, separated by -1 markers.
+ *      The paths are included in arbitrary order, as they are found
+ * from: The starting vertex_id
+ */
+void cga_dfs_ctx_vfree_from(cga_dfs_ctx_t *ctx, igraph_vector_int_t *res, igraph_integer_t from);
+
+/**
+ * Iteratively search all the valley free paths between two nodes using the given context,
+ * calling visitor for each path found instead of storing it.
+ * The branches that can't reach to are pruned with the table of cga_dfs_ctx_set_target.
+ * 
+ * Arguments:
+ * ctx: Pointer to the DFS context
+ * from: The starting vertex_id
+ * to: The ending vertex_id
+ * visitor: Function called for each path found, in arbitrary order
+ * arg: Argument passed to visitor
+ * 
+ * Returns CGA_DFS_STOPPED if the search has been stopped by the visitor, CGA_DFS_TRUNCATED if
+ * some paths have been cut by the limits of the context, CGA_DFS_DONE otherwise
+ */
+int cga_dfs_ctx_visit_it(cga_dfs_ctx_t *ctx, igraph_integer_t from, igraph_integer_t to, cga_path_visitor_t visitor, void *arg);
+
+/**
+ * Same as cga_dfs_ctx_vfree_from, calling visitor for each valley free path found instead of
+ * storing it. The target of each path is its last vertex.
+ * 
+ * Arguments:
+ * ctx: Pointer to the DFS context
+ * from: The starting vertex_id
+ * visitor: Function called for each path found, in arbitrary order
+ * arg: Argument passed to visitor
+ * 
+ * Returns CGA_DFS_STOPPED if the search has been stopped by the visitor, CGA_DFS_TRUNCATED if
+ * some paths have been cut by the limits of the context, CGA_DFS_DONE otherwise
+ */
+int cga_dfs_ctx_visit_from(cga_dfs_ctx_t *ctx, igraph_integer_t from, cga_path_visitor_t visitor, void *arg);
+
+/**
+ * Iteratively search all the valley free paths starting from a node, walking the valley free
+ * DFS tree only once: every path of the tree is a valley free path from the starting vertex
+ * to its last vertex, so a single search finds the paths towards all the targets.
+ * The resulting paths are stored in res. All paths are separated by -1 markers.
+ * 
+ * Arguments:
+ * graph: Pointer to the graph object
+ * res: Initialized vector, all the resulting paths are stored here, separated by -1 markers.
+ *      The paths are included in arbitrary order, as they are found
+ * from: The starting vertex_id
+ */
+void cga_dfs_vfree_from(cga_graph_t *graph, igraph_vector_int_t *res, igraph_integer_t from);
 
 /**
  * Calculate the cost of the valley free path as an algebraic sum of the relationships between
@@ -78,12 +486,14 @@ void cga_dfs_vfree_it(igraph_t *graph, igraph_vector_int_t *res, igraph_integer_
  * 
  * Returns the algebraic sum of the relationships between the Autonomous Systems
  */
-int cga_path_cost(igraph_t *graph, igraph_vector_int_t *path);
+int cga_path_cost(cga_graph_t *graph, igraph_vector_int_t *path);
 
 /**
  * Calculate the degree of freedom of the paths between two nodes.
  * Given all the paths between two nodes, this function count all the valley free and
- * no valley free paths. The formula for the degree of freedom of the paths between two nodes is
+ * no valley free paths. The paths are counted by a single DFS that tracks the valley free state
+ * of each prefix, without storing them, so the memory used is bounded by the length of the paths.
+ * The formula for the degree of freedom of the paths between two nodes is
  * calculated as: num_path_vfree / num_path_novfree.
  * If num_vfree and num_novfree pointers are not NULL, this function stores in these pointers the
  * number of valley free and no valley free paths.
@@ -99,18 +509,73 @@ int cga_path_cost(igraph_t *graph, igraph_vector_int_t *path);
  * 
  * Returns the degree of freedom of the paths between two nodes.
  */
-float cga_degree_freedom_path(igraph_t *graph, igraph_integer_t vertex1_id, igraph_integer_t vertex2_id, unsigned int *num_vfree, unsigned int *num_novfree);
+float cga_degree_freedom_path(cga_graph_t *graph, igraph_integer_t vertex1_id, igraph_integer_t vertex2_id, unsigned int *num_vfree, unsigned int *num_novfree);
+
+/**
+ * Search all the simple paths between two nodes, ignoring the relationships, and calls visitor
+ * for each of them. The state of the view tells if the path is valley free (state >= 0) or not
+ * (state -1). This is the search used by cga_degree_freedom_path.
+ * 
+ * Arguments:
+ * graph: Pointer to the graph object
+ * vertex1_id: The starting vertex
+ * vertex2_id: The ending vertex
+ * visitor: Function called for each path found, in arbitrary order
+ * arg: Argument passed to visitor
+ * 
+ * Returns 1 if the search has been stopped by the visitor, 0 otherwise
+ */
+int cga_degree_freedom_visit(cga_graph_t *graph, igraph_integer_t vertex1_id, igraph_integer_t vertex2_id, cga_path_visitor_t visitor, void *arg);
+
+/**
+ * Same as cga_degree_freedom_visit, with the given options (only the limits are used).
+ * 
+ * Arguments:
+ * graph: Pointer to the graph object
+ * vertex1_id: The starting vertex
+ * vertex2_id: The ending vertex
+ * visitor: Function called for each path found, in arbitrary order
+ * arg: Argument passed to visitor
+ * opts: Pointer to the options, initialized with cga_search_opts_init. If NULL the default
+ *       options are used
+ * 
+ * Returns CGA_DFS_STOPPED if the search has been stopped by the visitor, CGA_DFS_TRUNCATED if
+ * some paths have been cut by the limits, CGA_DFS_DONE otherwise
+ */
+int cga_degree_freedom_visit_opts(cga_graph_t *graph, igraph_integer_t vertex1_id, igraph_integer_t vertex2_id, cga_path_visitor_t visitor, void *arg, const cga_search_opts_t *opts);
+
+/**
+ * Same as cga_degree_freedom_path, with the given options (only the limits are used): the
+ * degree of freedom is computed on the paths found within the limits.
+ * 
+ * Arguments:
+ * graph: Pointer to the graph object
+ * vertex1_id: The starting vertex
+ * vertex2_id: The ending vertex
+ * num_vfree: Pointer to an unsigned int variable. If not NULL, the number of valley free paths
+ *            will be stored here
+ * num_nvfree: Pointer to an unsigned int variable. If not NULL, the number of no valley free
+ *             paths will be stored here
+ * truncated: Pointer to an int variable. If not NULL, 1 is stored here if some paths have been
+ *            cut by the limits, 0 otherwise
+ * opts: Pointer to the options, initialized with cga_search_opts_init. If NULL the default
+ *       options are used
+ * 
+ * Returns the degree of freedom of the paths found between two nodes.
+ */
+float cga_degree_freedom_path_opts(cga_graph_t *graph, igraph_integer_t vertex1_id, igraph_integer_t vertex2_id, unsigned int *num_vfree, unsigned int *num_novfree, int *truncated, const cga_search_opts_t *opts);
 
 /**
  * This function analyze and print in n files all the valley free paths from a node to
  * all other nodes, where n is the number of threads used to compute the analysis.
- * The search for paths is done through the use of cga_dfs_vfree_it function.
+ * The search for paths is done with a single valley free DFS from the given vertex (see
+ * cga_dfs_vfree_from), that reports each path to whichever target it reaches.
  * nthreads must be at least 1.  Specifying a number greater than 1 will use more
  * threads to compute the analysis.
- * Ideally the number of threads should be a divisor of the graph’s vertices number,
- * or at least less than that number. Each thread will have a range of vertices of the
- * graph to analyze, and the results will be stored in a file that uses the following
- * naming convention:
+ * Ideally the number of threads should be lower than the number of neighbors of the vertex:
+ * the DFS subtrees of the neighbors of the vertex (the first hops of the paths) are distributed
+ * among the threads by a work-stealing scheduler, the largest subtrees first, and the results
+ * of each thread will be stored in a file that uses the following naming convention:
  * For a generic thread n, given the name of the file filename, the file name will
  * be filename_n.csv.
  * filename shouldn’t have the extension of the file (it will be added automatically
@@ -131,19 +596,24 @@ float cga_degree_freedom_path(igraph_t *graph, igraph_integer_t vertex1_id, igra
  * filename: Part of the filename used to compose the name of the output file. It should not have
  *           the extension and can be a path (in this case the folders that compose the path must
  *           already exists)
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory,
+ * NWPERM if an output file can't be written.
  */
-cga_status_t cga_as_analysis(igraph_t *graph, igraph_integer_t vertex, unsigned int nthreads, char *filename);
+cga_status_t cga_as_analysis(cga_graph_t *graph, igraph_integer_t vertex, unsigned int nthreads, char *filename);
 
 /**
  * This function analyze and print in n files all the valley free paths from all nodes 
  * to all other nodes, where n is the number of threads used to compute the analysis.
- * The search for paths is done through the use of cga_dfs_vfree_it function.
+ * The search for paths is done through the use of cga_dfs_ctx_visit_it function, aggregating
+ * each path as soon as it is found. The pairs are searched target by target, so the table used
+ * to prune the branches that can't reach the target is computed once for each target, and the
+ * pairs without valley free paths are skipped without searching.
  * nthreads must be at least 1.  Specifying a number greater than 1 will use more
  * threads to compute the analysis.
- * Ideally the number of threads should be a divisor of the graph’s vertices number,
- * or at least less than that number. Each thread will have a range of vertices of the
- * graph to analyze, and the results will be stored in a file that uses the following
- * naming convention:
+ * The target vertices are distributed among the threads by a work-stealing scheduler,
+ * the ones with the largest estimated number of paths first, and the results of each thread
+ * will be stored in a file that uses the following naming convention:
  * For a generic thread n, given the name of the file filename, the file name will be
  * filename_n.csv.
  * filename shouldn’t have the extension of the file (it will be added automatically
@@ -166,6 +636,115 @@ cga_status_t cga_as_analysis(igraph_t *graph, igraph_integer_t vertex, unsigned
  * filename: Part of the name used to compose the name of the output file. It should not have
  *           the extension and can be a path (in this case the folders that compose the path
  *           must already exists)
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory,
+ * NWPERM if an output file can't be written.
+ */
+cga_status_t cga_graph_analysis(cga_graph_t *graph, unsigned int nthreads, char *filename);
+
+/**
+ * Options of cga_graph_analysis_opts. Initialize them with cga_analysis_opts_init, then change
+ * only the fields needed.
+ * 
+ * Fields:
+ * symmetric: If not 0, each unordered pair of nodes is searched only once. A valley free path
+ *            reversed is still a valley free path, with the same length and the opposite cost,
+ *            so the row <j, i> is written together with the row <i, j>, with the lengths
+ *            unchanged and the costs negated (the minimum cost of <j, i> is minus the maximum
+ *            cost of <i, j> and vice versa). The output has the same rows of the default mode,
+ *            in a different order, for half of the searches. Default 0
+ * limits: The limits of the search of each pair (see cga_dfs_limits_t). If any limit is set,
+ *         the output has a further column <truncated>, 1 if the paths of the pair have been
+ *         cut by the limits (so the statistics are computed on a part of them) and 0 otherwise;
+ *         the truncated pairs are printed even if no path has been found, with empty statistics.
+ *         Default no limits
+ * consolidated: If not 0, the results of all the threads are written in the single file
+ *               filename.csv instead of one file per thread: the threads push them in lock-free
+ *               ring buffers drained by a dedicated writer thread (see output.h), so they never
+ *               wait for the formatting or the disk. The rows of different threads are
+ *               interleaved in arbitrary order. Default 0
+ * binary: If not 0, the results are written in the binary format of pairs.h (24 bytes per pair,
+ *         tagged with the fingerprint of the graph) in files with the extension CGA_PAIRS_EXT
+ *         instead of .csv. In the symmetric mode only the record <i, j> is written, the row
+ *         <j, i> is given back by the reader. cga_pairs_to_csv() converts the files in the same
+ *         CSV of the default mode. Default 0
+ * indexed: If not 0, the results are written in binary files (as if binary were set) and at the
+ *          end of the run they are sorted and merged in the indexed result file
+ *          filename.CGA_RESULT_EXT, that can be mapped and queried in O(log n) by <from, to>
+ *          (see result.h). The binary files are kept, sorted. Default 0
+ * checkpoint_interval: If greater than 0, every checkpoint_interval seconds each thread flushes
+ *                      its output file to the disk (fsync) and records in its manifest
+ *                      filename_n.CGA_CHECKPOINT_EXT the targets completed so far and the size
+ *                      of the file holding their rows (see checkpoint.h). Each checkpoint costs
+ *                      an fsync, so the overhead is about the time of an fsync every interval.
+ *                      Not available with consolidated (the analysis fails with WRFORMAT).
+ *                      Default 0, no checkpoints
+ * resume: If not 0, the run goes on from the manifests of a previous run with the same graph,
+ *         vertex_ids (e.g. the same cga_graph_reorder), options and number of threads, interrupted after its checkpoints: each output file
+ *         is truncated to the size recorded in its manifest and the completed targets are not
+ *         searched again. A thread without a manifest starts from scratch. Not available with
+ *         consolidated (the analysis fails with WRFORMAT). Default 0
+ */
+typedef struct _cga_analysis_opts {
+    int symmetric;
+    int consolidated;
+    int binary;
+    int indexed;
+    double checkpoint_interval;
+    int resume;
+    cga_dfs_limits_t limits;
+} cga_analysis_opts_t;
+
+/**
+ * Sets the options to their default values, the ones used by cga_graph_analysis.
+ * 
+ * Arguments:
+ * opts: Pointer to the options
+ */
+void cga_analysis_opts_init(cga_analysis_opts_t *opts);
+
+/**
+ * Same as cga_graph_analysis, with the given options.
+ * 
+ * Arguments:
+ * graph: Pointer to the graph object
+ * nthreads: The number of threads used to analyze the vertex's paths. The given value must be
+ *           at last greater or equal to 1
+ * filename: Part of the name used to compose the name of the output file. It should not have
+ *           the extension and can be a path (in this case the folders that compose the path
+ *           must already exists)
+ * opts: Pointer to the options, initialized with cga_analysis_opts_init. If NULL the default
+ *       options are used
+ * 
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory,
+ * NWPERM if an output, the consolidated or the indexed file can't be written, WRFORMAT if the
+ * manifests to resume from belong to a different run or don't match their output files, or if
+ * consolidated is combined with checkpoint_interval or resume.
+ */
+cga_status_t cga_graph_analysis_opts(cga_graph_t *graph, unsigned int nthreads, char *filename, const cga_analysis_opts_t *opts);
+
+/**
+ * This function analyze and print in n files the shortest valley free paths from all nodes
+ * to all other nodes, where n is the number of threads used to compute the analysis.
+ * Instead of enumerating every valley free path like cga_graph_analysis, it runs from each
+ * starting vertex a breadth first search over the product graph <vertex, valley free state>,
+ * so each starting vertex costs O(V + E) and the whole analysis O(V * (V + E)).
+ * The threads and the output files follow the same conventions of cga_graph_analysis.
+ * The header <from, to, length, min cost, max cost, paths> represents the starting
+ * autonomous system, the target autonomous system, the length of the shortest valley free
+ * paths between the two nodes, the minimum and the maximum cost among those paths and
+ * the number of shortest valley free paths. Pairs without valley free paths are not printed.
+ * 
+ * Arguments:
+ * graph: Pointer to the graph object
+ * nthreads: The number of threads used to analyze the graph. The given value must be
+ *           at last greater or equal to 1
+ * filename: Part of the name used to compose the name of the output file. It should not have
+ *           the extension and can be a path (in this case the folders that compose the path
+ *           must already exists)
+ * 
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory,
+ * NWPERM if an output file can't be written.
  */
-cga_status_t cga_graph_analysis(igraph_t *graph, unsigned int nthreads, char *filename);
+cga_status_t cga_graph_analysis_shortest(cga_graph_t *graph, unsigned int nthreads, char *filename);
 #endif
\ No newline at end of file
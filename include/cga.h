@@ -2,9 +2,22 @@
 #define CGA_H_uahsdopfihaosdknfloxcvz
 
 #include "as_relationship.h"
+#include "checkpoint.h"
+#include "cone.h"
+#include "graph.h"
 #include "hash.h"
 #include "hashset.h"
 #include "hashtable.h"
+#include "output.h"
+#include "pairs.h"
+#include "reorder.h"
+#include "result.h"
+#include "sampling.h"
+#include "scheduler.h"
+#include "snapshot.h"
+#include "stats.h"
 #include "status.h"
+#include "visited.h"
 #include "display.h"
+#include "writer.h"
 #endif
\ No newline at end of file
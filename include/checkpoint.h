@@ -0,0 +1,78 @@
+#ifndef CHECKPOINT_H_wqazxsedcvfrtgbnhyujmkiolp
+#define CHECKPOINT_H_wqazxsedcvfrtgbnhyujmkiolp
+
+#include <stdint.h>
+#include "status.h"
+
+#define CGA_CHECKPOINT_MAGIC "CGACKPT"
+#define CGA_CHECKPOINT_VERSION 2
+#define CGA_CHECKPOINT_EXT "ckpt"  // extension of the manifest files
+
+/**
+ * Header of the manifest of a worker of a long analysis: it records which tasks the worker has
+ * completed and how many bytes of its output file hold their results, so a restarted run can
+ * truncate the file there and go on with the other tasks. The header is followed by ndone
+ * uint32_t, the completed tasks.
+ * fingerprint and options identify the graph and the options of the run, so a manifest is never
+ * used to resume a different analysis. The tasks are vertex_ids, so order identifies the
+ * vertex_ids of the graph too: the same graph with its vertices in another order (e.g. after
+ * cga_graph_reorder) has the same fingerprint but a different order.
+ * All the values are stored in the byte order of the machine that wrote the file.
+ */
+typedef struct _cga_checkpoint_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t fingerprint;
+    uint64_t order;
+    uint64_t options;
+    uint32_t worker;
+    uint32_t nworkers;
+    uint64_t offset;
+    uint64_t ndone;
+} cga_checkpoint_header_t;
+
+/**
+ * Fills the header of a manifest with no completed tasks.
+ *
+ * Arguments:
+ * header: Pointer to the header
+ * fingerprint: The fingerprint of the graph (see cga_graph_fingerprint)
+ * order: A value identifying the vertex_ids of the graph
+ * options: A value identifying the options of the run
+ * worker: The index of the worker
+ * nworkers: The number of workers of the run
+ */
+void cga_checkpoint_header_init(cga_checkpoint_header_t *header, uint64_t fingerprint, uint64_t order, uint64_t options, uint32_t worker, uint32_t nworkers);
+
+/**
+ * Writes a manifest durably: the file is written with a temporary name, flushed to the disk
+ * with fsync, then renamed over the previous manifest, so a crash at any time leaves either the
+ * previous manifest or the new one. The output file the manifest refers to must already have
+ * been flushed to the disk up to header->offset.
+ *
+ * Arguments:
+ * path: Path of the manifest
+ * header: Pointer to the header, with ndone set
+ * done: Array of the ndone completed tasks
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory,
+ * NWPERM if the file can't be written.
+ */
+cga_status_t cga_checkpoint_save(const char *path, const cga_checkpoint_header_t *header, const uint32_t *done);
+
+/**
+ * Reads a manifest written by cga_checkpoint_save.
+ *
+ * Arguments:
+ * path: Path of the manifest
+ * header: Pointer where the header is stored
+ * done: Pointer where the array of the completed tasks is stored. It must be freed with free()
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory,
+ * NFOUND if there's no manifest, NRPERM if it can't be read, WRFORMAT if it is not a valid
+ * manifest of this version.
+ */
+cga_status_t cga_checkpoint_load(const char *path, cga_checkpoint_header_t *header, uint32_t **done);
+
+#endif
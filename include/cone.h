@@ -0,0 +1,102 @@
+#ifndef CONE_H_rtyuifghjvbnmqweasdzxcpl
+#define CONE_H_rtyuifghjvbnmqweasdzxcpl
+
+#include <stdint.h>
+#include "graph.h"
+#include "status.h"
+
+/**
+ * Customer cones of all the vertices of a graph.
+ * The customer cone of an AS is the AS itself together with all the ASes it can reach following
+ * only provider-to-customer edges: once a valley free path goes downhill it can't leave the cone
+ * of the AS where it started going down.
+ * Each cone is stored as a compressed bitset in the style of Roaring bitmaps: the vertex_ids are
+ * split in blocks of 65536 by their upper bits, and each non empty block is stored either as a
+ * sorted array of the lower 16 bits (up to 4096 elements) or as a bitmap of 65536 bits, so small
+ * cones (the vast majority, stub ASes have a cone of one element) take a few bytes and the cones
+ * of the large transit providers at most 8KB per block.
+ * The cones are read-only once computed, so they can be shared by many threads.
+ */
+typedef struct _cga_cones cga_cones_t;
+
+/**
+ * Computes the customer cones of all the vertices of the graph.
+ * Every cones object created by this function should be destroyed with cga_cones_destroy().
+ *
+ * Arguments:
+ * graph: Pointer to the graph object
+ *
+ * Returns a pointer to the newly created cones, NULL if there's not enough memory
+ */
+cga_cones_t *cga_cones_init(const cga_graph_t *graph);
+
+/**
+ * Destroys a cones object.
+ *
+ * Arguments:
+ * cones: Pointer to the (previously initialized) cones to destroy
+ */
+void cga_cones_destroy(cga_cones_t *cones);
+
+/**
+ * Tells if the vertex w is in the customer cone of the vertex v.
+ * Every vertex is in its own customer cone.
+ *
+ * Arguments:
+ * cones: Pointer to the cones object
+ * v: The vertex_id owning the cone
+ * w: The vertex_id to look for
+ *
+ * Returns 1 if w is in the customer cone of v, 0 otherwise
+ */
+int cga_cones_contains(const cga_cones_t *cones, uint32_t v, uint32_t w);
+
+/**
+ * Gives the size of the customer cone of the vertex v, the vertex itself included.
+ *
+ * Arguments:
+ * cones: Pointer to the cones object
+ * v: The vertex_id owning the cone
+ *
+ * Returns the number of vertices in the customer cone of v
+ */
+uint32_t cga_cones_size(const cga_cones_t *cones, uint32_t v);
+
+/**
+ * Stores in members the vertex_ids of the customer cone of v, sorted.
+ *
+ * Arguments:
+ * cones: Pointer to the cones object
+ * v: The vertex_id owning the cone
+ * members: Array where the vertex_ids are stored, it must have room for cga_cones_size(cones, v) elements
+ */
+void cga_cones_members(const cga_cones_t *cones, uint32_t v, uint32_t *members);
+
+/**
+ * Writes the cones in a binary file, to be stored next to the snapshot of the graph and loaded
+ * with cga_cones_load instead of computing them again.
+ *
+ * Arguments:
+ * cones: Pointer to the cones object
+ * path: Path of the file. The folders forming the path must already exist
+ *
+ * Returns SUCCESS if the operation completed without errors, NWPERM if the file can't be written.
+ */
+cga_status_t cga_cones_save(const cga_cones_t *cones, const char *path);
+
+/**
+ * Reads the cones written by cga_cones_save. The file stores a fingerprint of the topology it
+ * has been computed from, so cones of a different graph (e.g. of an older snapshot) are refused.
+ *
+ * Arguments:
+ * cones: Pointer where the newly created cones object is stored. It should be destroyed with
+ *        cga_cones_destroy()
+ * graph: Pointer to the graph object the cones refer to
+ * path: Path of the file
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory,
+ * NRPERM if the file can't be opened, WRFORMAT if the file is not valid or belongs to another graph.
+ */
+cga_status_t cga_cones_load(cga_cones_t **cones, const cga_graph_t *graph, const char *path);
+
+#endif
@@ -2,14 +2,17 @@
 #define DISPLAY_H_noadvnbzxocuivboivchblkjhasdfoiu
 
 #include <igraph/igraph.h>
+#include <stdio.h>
+#include "as_relationship.h"
+#include "graph.h"
 
 /**
- * Prints in stdout the number of vertices, edges and the type of the given graph
+ * Prints in stdout the number of vertices and AS relationships of the given graph
  * 
  * Arguments:
  * graph: Pointer to the graph object
  */
-void cga_print_info(igraph_t *graph);
+void cga_print_info(cga_graph_t *graph);
 
 /**
  * Converts the vertex_ids in the input vector v in as_numbers and prints them in the file.
@@ -19,7 +22,21 @@ void cga_print_info(igraph_t *graph);
  * v: Vector containing vertex_ids of the graph
  * ostream: File pointer used as output
  */
-void cga_print_vector_label(igraph_t *graph, igraph_vector_int_t *v, FILE *ostream);
+void cga_print_vector_label(cga_graph_t *graph, igraph_vector_int_t *v, FILE *ostream);
+
+/**
+ * Prints in the file ostream the as_numbers of the path, followed by its length and cost.
+ * It can be given directly as visitor to the path searches, e.g.
+ * cga_dfs_ctx_visit_it(ctx, from, to, cga_print_path_label, stdout) prints the paths as they are found.
+ * 
+ * Arguments:
+ * graph: Pointer to the graph object
+ * path: Pointer to the view of the path
+ * ostream: File pointer used as output
+ * 
+ * Returns 0, so the search continues
+ */
+int cga_print_path_label(cga_graph_t *graph, const cga_path_view_t *path, void *ostream);
 
 /**
  * Calculates the degree of freedom of the paths between two nodes using cga_degree_freedom_path
@@ -30,7 +47,7 @@ void cga_print_vector_label(igraph_t *graph, igraph_vector_int_t *v, FILE *ostre
  * vertex1_id: The starting vertex used to calculate the degree of freedom
  * vertex2_id: The ending vertex used to calculate the degree of freedom
  */
-void cga_print_degree_freedom_path(igraph_t *graph, igraph_integer_t vertex1_id, igraph_integer_t vertex2_id);
+void cga_print_degree_freedom_path(cga_graph_t *graph, igraph_integer_t vertex1_id, igraph_integer_t vertex2_id);
 
 /**
  * Prints the as_numbers of the graph as an adjacency list in stdout
@@ -38,7 +55,7 @@ void cga_print_degree_freedom_path(igraph_t *graph, igraph_integer_t vertex1_id,
  * Arguments:
  * graph: Pointer to the graph object
  */
-void cga_print_adj(igraph_t *graph);
+void cga_print_adj(cga_graph_t *graph);
 
 /**
  * Given a vector containing a list of paths separated by -1 marker, this function prints
@@ -51,7 +68,7 @@ void cga_print_adj(igraph_t *graph);
  * res: Pointer to a vector containing a list of paths separated by -1 marker
  * ostream: File pointer used as output
  */
-void cga_print_result_label_vfree(igraph_t *graph, igraph_vector_int_t *res, FILE *ostream);
+void cga_print_result_label_vfree(cga_graph_t *graph, igraph_vector_int_t *res, FILE *ostream);
 
 /**
  * Given a vector containing a list of paths separated by -1 marker, this function prints
@@ -63,5 +80,5 @@ void cga_print_result_label_vfree(igraph_t *graph, igraph_vector_int_t *res, FIL
  * res: Pointer to a vector containing a list of paths separated by -1 marker
  * ostream: File pointer used as output
  */
-void cga_print_result_label(igraph_t *graph, igraph_vector_int_t *res, FILE *ostream);
+void cga_print_result_label(cga_graph_t *graph, igraph_vector_int_t *res, FILE *ostream);
 #endif
\ No newline at end of file
@@ -0,0 +1,192 @@
+#ifndef GRAPH_H_pqowieuvnzxbcvaldkfjghsd
+#define GRAPH_H_pqowieuvnzxbcvaldkfjghsd
+
+#include <igraph/igraph.h>
+#include <stdint.h>
+#include "status.h"
+
+/**
+ * Relationship between two Autonomous Systems, seen from the first one.
+ * The numeric values are the same used in the CAIDA as-rel files, extended with
+ * customer-to-provider (the reverse direction of a provider-to-customer link), so the cost
+ * of a path is the algebraic sum of the relationships of its hops.
+ */
+#define CGA_REL_P2C (-1)
+#define CGA_REL_P2P 0
+#define CGA_REL_C2P 1
+
+/**
+ * Packing of an adjacency entry: the neighbor vertex_id is stored in the upper 30 bits,
+ * the relationship (shifted by one, so that it fits in 2 unsigned bits) in the lower 2 bits.
+ * Sorting the packed words sorts the adjacency list by neighbor vertex_id.
+ */
+#define CGA_ADJ_PACK(v, rel) (((uint32_t)(v) << 2) | (uint32_t)((rel) + 1))
+#define CGA_ADJ_VERTEX(w) ((uint32_t)(w) >> 2)
+#define CGA_ADJ_REL(w) ((int)((w) & 3u) - 1)
+#define CGA_GRAPH_MAX_VERTICES (UINT32_C(1) << 30)
+
+/**
+ * Entry of the as_number -> vertex_id index, sorted by as_number.
+ */
+typedef struct _cga_asn_index {
+    uint64_t asn;
+    uint32_t id;
+    uint32_t reserved;
+} cga_asn_index_t;
+
+/**
+ * Compact read-only topology of an AS graph in CSR (compressed sparse row) form.
+ * Every AS relationship is stored in both endpoints' adjacency lists, so the neighbors of a
+ * vertex are the union of its providers, customers and peers, each one annotated with the
+ * relationship as seen from the vertex itself:
+ * adj[offsets[v]] ... adj[offsets[v + 1] - 1] are the packed neighbors of v, sorted by vertex_id.
+ * labels[v] is the as_number of the vertex v.
+ * A graph opened from a binary snapshot (see snapshot.h) keeps its arrays in the mapped file.
+ * The fields must be considered read-only; use the functions below to create and destroy it.
+ */
+typedef struct _cga_graph {
+    uint32_t vcount;
+    uint32_t ecount;
+    uint32_t *offsets;
+    uint32_t *adj;
+    unsigned long *labels;
+    cga_asn_index_t *index;  // as_numbers sorted with their vertex_id, NULL if not available
+    void *mapping;           // memory mapped snapshot holding the arrays, NULL if they are allocated
+    size_t mapping_size;
+} cga_graph_t;
+
+/**
+ * An AS relationship used to build the graph: from and to are vertex_ids, rel is the
+ * relationship of from towards to (CGA_REL_P2C or CGA_REL_P2P, as found in the as-rel files).
+ */
+typedef struct _cga_edge {
+    uint32_t from;
+    uint32_t to;
+    int rel;
+} cga_edge_t;
+
+/**
+ * Number of vertices of the graph
+ */
+#define cga_graph_vcount(graph) ((graph)->vcount)
+
+/**
+ * Number of neighbors of the vertex v
+ */
+#define cga_graph_degree(graph, v) ((graph)->offsets[(v) + 1] - (graph)->offsets[(v)])
+
+/**
+ * as_number of the vertex v
+ */
+#define cga_graph_label(graph, v) ((graph)->labels[(v)])
+
+/**
+ * Step of the valley free automaton used by the path searches.
+ * State 0 means that the path is still going uphill (only customer-to-provider edges so far),
+ * state 1 means that the path has crossed a peer-to-peer or a provider-to-customer edge and can
+ * only go downhill. -1 means that the path is not valley free anymore.
+ *
+ * Arguments:
+ * state: The current state of the automaton (0 or 1)
+ * rel: The relationship of the next hop
+ *
+ * Returns the new state of the automaton
+ */
+static inline int cga_vf_state(int state, int rel) {
+    if (state == 0)
+        return rel == CGA_REL_C2P ? 0 : 1;
+    return rel == CGA_REL_P2C ? 1 : -1;
+}
+
+/**
+ * Builds the CSR topology from a list of AS relationships.
+ * Each relationship is stored in both endpoints, duplicated relationships between the same
+ * pair of vertices are stored only once. The labels are initialized to 0 and can be set by
+ * the caller through the labels field.
+ * Every graph built by this function should be destroyed with cga_graph_destroy().
+ *
+ * Arguments:
+ * graph: Pointer to an uninitialized graph object
+ * vcount: The number of vertices of the graph. Every vertex_id in edges must be lower than vcount
+ * edges: Array of relationships
+ * nedges: Number of elements of edges
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory,
+ * WRFORMAT if an edge refers to a vertex_id out of range.
+ */
+cga_status_t cga_graph_init(cga_graph_t *graph, uint32_t vcount, const cga_edge_t *edges, size_t nedges);
+
+/**
+ * Sorts a packed adjacency list by neighbor vertex_id, the order of the lists of the graphs.
+ *
+ * Arguments:
+ * adj: Array of packed adjacency words (see CGA_ADJ_PACK)
+ * n: Number of elements of adj
+ */
+void cga_graph_sort_adj(uint32_t *adj, size_t n);
+
+/**
+ * Frees the memory used by the graph.
+ *
+ * Arguments:
+ * graph: Pointer to the (previously initialized) graph object to destroy
+ */
+void cga_graph_destroy(cga_graph_t *graph);
+
+/**
+ * Gives the relationship of the vertex from towards the vertex to.
+ * If the two vertices are not adjacent the hop is treated as a customer-to-provider edge,
+ * as cga_path_cost() and cga_is_valley_free() always did.
+ *
+ * Arguments:
+ * graph: Pointer to the graph object
+ * from: The first vertex_id
+ * to: The second vertex_id
+ *
+ * Returns CGA_REL_P2C, CGA_REL_P2P or CGA_REL_C2P
+ */
+int cga_graph_relation(const cga_graph_t *graph, uint32_t from, uint32_t to);
+
+/**
+ * Gives the vertex_id of an as_number.
+ * If the graph has an as_number index (e.g. it has been opened with cga_snapshot_open()) the
+ * search is a binary search, otherwise all the labels are scanned.
+ *
+ * Arguments:
+ * graph: Pointer to the graph object
+ * asn: The as_number to look for
+ *
+ * Returns the vertex_id of the as_number, -1 if the as_number is not in the graph
+ */
+igraph_integer_t cga_graph_find(const cga_graph_t *graph, unsigned long asn);
+
+/**
+ * Computes a 64 bit fingerprint of the topology: the hash of every relationship, identified by
+ * the as_numbers of its endpoints, summed over all of them. It doesn't depend on the vertex_ids,
+ * so a graph reordered with cga_graph_reorder(), or loaded again from the same as-rel file or
+ * snapshot, has the same fingerprint. Used to tie result files to the graph they come from.
+ *
+ * Arguments:
+ * graph: Pointer to the graph object
+ *
+ * Returns the fingerprint
+ */
+uint64_t cga_graph_fingerprint(const cga_graph_t *graph);
+
+/**
+ * Exports the graph as an igraph object with the same layout cga_load_snapshot() used to build:
+ * a partially directed graph with directed provider-to-customer edges and peer-to-peer edges
+ * stored as a couple of opposite directed edges.
+ * Each vertex has a numeric attribute "label" (the as_number) and each edge has a numeric
+ * attribute "type" (-1 for provider-to-customer, 0 for peer-to-peer).
+ * N.B. The igraph attribute table must be set with igraph_i_set_attribute_table(&igraph_cattribute_table).
+ *
+ * Arguments:
+ * graph: Pointer to the graph object
+ * out: Pointer to an uninitialized igraph object
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory.
+ */
+cga_status_t cga_graph_to_igraph(const cga_graph_t *graph, igraph_t *out);
+
+#endif
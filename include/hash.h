@@ -7,4 +7,10 @@
   */
 unsigned long cga_hash(unsigned long key);
 
+ /** Integer hash function based on the finalizer of MurmurHash3 (fmix64) by Austin Appleby.
+  * It mixes all the bits of the key with two multiplications and three shifts, so it is much
+  * cheaper than the byte-wise cga_hash and well suited for power-of-two sized tables.
+  */
+unsigned long cga_hash_int(unsigned long key);
+
 #endif
\ No newline at end of file
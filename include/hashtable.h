@@ -7,12 +7,14 @@
 typedef struct _cga_hashtable cga_hashtable_t;
 
 /**
- * Creates a cga_hashtable_t object of the given size.
+ * Creates a cga_hashtable_t object able to hold the given number of keys.
+ * The hashtable uses open addressing (Robin Hood linear probing) and grows automatically
+ * when it gets full, so size is only a hint to avoid the first resizes.
  * Every hashtable object created by this function shoudl be destroyed (ie. the memory allocated
  * for it should be freed) when it is not needed anymore with the function cga_ht_destroy()
  * 
  * Arguments:
- * size: The maximum size of the hashtable
+ * size: The expected number of keys of the hashtable
  * 
  * Returns a pointer to the newly created hashtable object
  */
@@ -36,6 +38,17 @@ void cga_ht_destroy(cga_hashtable_t *ht);
  */
 void cga_ht_clear(cga_hashtable_t *ht);
 
+/**
+ * Grows the hashtable so that it can hold nelem keys without any further resize.
+ * 
+ * Arguments:
+ * ht: Pointer to the hashtable object
+ * nelem: The number of keys the hashtable should hold
+ * 
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory.
+ */
+cga_status_t cga_ht_reserve(cga_hashtable_t *ht, size_t nelem);
+
 /**
  * Inserts the assotiation <key, value> in the hashtable. Any duplicated key values won't be
  * inserted.
@@ -68,7 +81,8 @@ int cga_ht_contains(cga_hashtable_t *ht, unsigned long key);
  * ht: Pointer to the hashtable object
  * key: The key to look for
  * 
- * Returns the value to which the specified key is mapped, NULL otherwise.
+ * Returns a pointer to the value to which the specified key is mapped, NULL otherwise.
+ * The pointer is valid until the next insertion or deletion.
  */
 igraph_integer_t* cga_ht_search(cga_hashtable_t *ht, unsigned long key);
 
@@ -95,6 +109,17 @@ cga_status_t cga_ht_delete(cga_hashtable_t *ht, unsigned long key);
  */
 size_t cga_ht_nelems(cga_hashtable_t *ht);
 
+/**
+ * Calls visitor on every association <key, value> of the hashtable, in no particular order.
+ * The visitor can change the value through its pointer, but must not insert or delete keys.
+ * 
+ * Arguments:
+ * ht: Pointer to the hashtable object
+ * visitor: Function called with the key, a pointer to its value and arg
+ * arg: Argument passed to visitor
+ */
+void cga_ht_foreach(cga_hashtable_t *ht, void (*visitor)(unsigned long key, igraph_integer_t *value, void *arg), void *arg);
+
 /**
  * Saves all the association <key, value> of the hashtable in the specified file.
  * The format of the resulting file correspons to:
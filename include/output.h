@@ -0,0 +1,76 @@
+#ifndef OUTPUT_H_mnbvcxzlkjhgfdsapoiuytrew
+#define OUTPUT_H_mnbvcxzlkjhgfdsapoiuytrew
+
+#include <stddef.h>
+#include "status.h"
+#include "writer.h"
+
+#define CGA_OUTPUT_CAPACITY 4096  // default number of records of each ring
+
+/**
+ * Output pipeline writing the results of many compute threads in a single file.
+ * Each compute thread (producer) pushes fixed-size records into its own single-producer
+ * single-consumer ring buffer, without locks: a push is a copy of the record and an atomic store.
+ * A dedicated writer thread drains the rings, formats the records with the given function and
+ * writes them through a cga_writer_t with large sequential writes, so the compute threads never
+ * wait for the formatting or for the disk (unless a ring is full: then the producer waits for
+ * the writer, which bounds the memory used).
+ * The records of different producers are interleaved in the file in arbitrary order.
+ */
+typedef struct _cga_output cga_output_t;
+
+/**
+ * Function formatting a record as a line of the output file.
+ *
+ * Arguments:
+ * out: Pointer to the writer of the output file
+ * record: Pointer to the record
+ * arg: The argument given to cga_output_open
+ */
+typedef void (*cga_record_format_t)(cga_writer_t *out, const void *record, void *arg);
+
+/**
+ * Creates the output file, writes its header and starts the writer thread.
+ * Every output opened by this function should be closed with cga_output_close().
+ *
+ * Arguments:
+ * output: Pointer where the newly created output is stored
+ * path: Path of the file. The folders forming the path must already exist
+ * header: The first bytes of the file (e.g. the header line of a CSV), or NULL
+ * header_size: The number of bytes of header
+ * nproducers: The number of compute threads that push records, each one with its own ring
+ * record_size: The size in bytes of a record
+ * capacity: The number of records of each ring, rounded up to a power of two.
+ *           0 for CGA_OUTPUT_CAPACITY
+ * format: Function formatting the records, called by the writer thread only
+ * arg: Argument passed to format
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory
+ * or the writer thread can't be started, NWPERM if the file can't be created.
+ */
+cga_status_t cga_output_open(cga_output_t **output, const char *path, const void *header, size_t header_size, unsigned int nproducers, size_t record_size, size_t capacity, cga_record_format_t format, void *arg);
+
+/**
+ * Pushes a record in the ring of a producer. If the ring is full it waits for the writer thread
+ * to make room.
+ * Each producer must use its own index, and only one thread at a time can use it.
+ *
+ * Arguments:
+ * output: Pointer to the output
+ * producer: The index of the producer, in [0, nproducers)
+ * record: Pointer to the record_size bytes of the record, copied in the ring
+ */
+void cga_output_push(cga_output_t *output, unsigned int producer, const void *record);
+
+/**
+ * Waits for the writer thread to write all the records pushed so far, then closes the file and
+ * frees the output. Call it after all the producers have finished.
+ *
+ * Arguments:
+ * output: Pointer to the output
+ *
+ * Returns SUCCESS if all the writes completed without errors, NWPERM otherwise.
+ */
+cga_status_t cga_output_close(cga_output_t *output);
+
+#endif
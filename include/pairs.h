@@ -0,0 +1,183 @@
+#ifndef PAIRS_H_zmxncbvlaksjdhfgqpwoeiruty
+#define PAIRS_H_zmxncbvlaksjdhfgqpwoeiruty
+
+#include <stddef.h>
+#include <stdint.h>
+#include "as_relationship.h"
+#include "graph.h"
+#include "status.h"
+#include "writer.h"
+
+#define CGA_PAIRS_MAGIC "CGAPAIR"
+#define CGA_PAIRS_VERSION 1
+#define CGA_PAIRS_EXT "cgp"  // extension of the binary result files
+
+// headers of the CSV files of cga_graph_analysis, without and with the column <truncated>
+#define CGA_PAIRS_CSV_HEADER "from, to, avg length, min length, max length, avg cost, min cost, max cost\n"
+#define CGA_PAIRS_CSV_HEADER_LIMITED "from, to, avg length, min length, max length, avg cost, min cost, max cost, truncated\n"
+
+/**
+ * Flags of a binary result file.
+ * CGA_PAIRS_LIMITED: the searches were limited, so the CSV has the column <truncated>
+ * CGA_PAIRS_SYMMETRIC: each record <from, to> also stands for the record <to, from>, with the
+ *                      same lengths and the opposite costs (see cga_analysis_opts_t.symmetric)
+ */
+#define CGA_PAIRS_LIMITED 1u
+#define CGA_PAIRS_SYMMETRIC 2u
+
+/**
+ * Flags of a record.
+ * CGA_PAIR_EMPTY: no path has been found (the pair has been cut by the limits), the statistics
+ *                 are meaningless
+ * CGA_PAIR_TRUNCATED: the paths of the pair have been cut by the limits
+ * CGA_PAIR_SATURATED: a length or a cost didn't fit its field and has been clamped
+ */
+#define CGA_PAIR_EMPTY 1u
+#define CGA_PAIR_TRUNCATED 2u
+#define CGA_PAIR_SATURATED 4u
+
+/**
+ * Header of a binary result file of cga_graph_analysis. The file is the header followed by
+ * fixed-size cga_pair_record_t records up to its end, so it can be mapped and read in place and
+ * a file cut by a crash still holds all the records written before.
+ * The fingerprint is the one of the graph analyzed (see cga_graph_fingerprint), so the results
+ * can be checked against the snapshot they are read with.
+ * All the values are stored in the byte order of the machine that wrote the file.
+ */
+typedef struct _cga_pairs_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t record_size;
+    uint32_t flags;
+    uint64_t fingerprint;
+    uint32_t vcount;
+    uint32_t ecount;
+} cga_pairs_header_t;
+
+/**
+ * Statistics of the valley free paths between two autonomous systems, 24 bytes instead of the
+ * about 50 of a CSV row. The averages are the same single precision values the CSV prints with
+ * three decimals, so the conversion back to CSV gives the same text.
+ *
+ * Fields:
+ * from: The as_number of the starting autonomous system
+ * to: The as_number of the target autonomous system
+ * avg_length: The average length of the paths
+ * avg_cost: The average cost of the paths
+ * length_min, length_max: The minimum and the maximum length, clamped to 255
+ * flags: CGA_PAIR_* flags
+ * cost_min, cost_max: The minimum and the maximum cost
+ */
+typedef struct _cga_pair_record {
+    uint32_t from;
+    uint32_t to;
+    float avg_length;
+    float avg_cost;
+    uint8_t length_min;
+    uint8_t length_max;
+    uint8_t flags;
+    uint8_t reserved;
+    int16_t cost_min;
+    int16_t cost_max;
+} cga_pair_record_t;
+
+/**
+ * Binary result file opened for reading.
+ *
+ * Fields:
+ * header: Pointer to the header of the file
+ * records: Pointer to the first record
+ * count: The number of records
+ * mapping, mapping_size: The memory mapped file
+ */
+typedef struct _cga_pairs {
+    const cga_pairs_header_t *header;
+    const cga_pair_record_t *records;
+    size_t count;
+    void *mapping;
+    size_t mapping_size;
+} cga_pairs_t;
+
+/**
+ * Fills the header of a binary result file for the results of graph.
+ *
+ * Arguments:
+ * header: Pointer to the header
+ * graph: Pointer to the graph object analyzed
+ * flags: CGA_PAIRS_* flags
+ */
+void cga_pairs_header_init(cga_pairs_header_t *header, const cga_graph_t *graph, uint32_t flags);
+
+/**
+ * Converts the statistics of a pair of nodes in a record.
+ *
+ * Arguments:
+ * record: Pointer to the record
+ * graph: Pointer to the graph object
+ * from: The vertex_id of the starting node
+ * to: The vertex_id of the target node
+ * stats: Pointer to the statistics of the paths from from to to
+ * truncated: 1 if the paths of the pair have been cut by the limits, 0 otherwise
+ */
+void cga_pair_record_init(cga_pair_record_t *record, const cga_graph_t *graph, uint32_t from, uint32_t to, const cga_pair_stats_t *stats, int truncated);
+
+/**
+ * Writes a record as a CSV row of cga_graph_analysis.
+ *
+ * Arguments:
+ * out: Pointer to the writer
+ * record: Pointer to the record
+ * reversed: If not 0 the row <to, from> is written instead, with the costs negated
+ * limited: If not 0 the column <truncated> is written
+ */
+void cga_pair_record_csv(cga_writer_t *out, const cga_pair_record_t *record, int reversed, int limited);
+
+/**
+ * Opens a binary result file, mapping it in memory.
+ * The records are read in place: opening the file takes constant time. A trailing partial
+ * record (e.g. of a file cut by a crash) is ignored.
+ * Every file opened by this function should be closed with cga_pairs_close().
+ *
+ * Arguments:
+ * pairs: Pointer to an uninitialized cga_pairs_t
+ * path: Path of the file
+ *
+ * Returns SUCCESS if the operation completed without errors, NRPERM if the file can't be opened,
+ * WRFORMAT if the file is not a binary result file of this version.
+ */
+cga_status_t cga_pairs_open(cga_pairs_t *pairs, const char *path);
+
+/**
+ * Checks that the results have been computed on the given graph.
+ *
+ * Arguments:
+ * pairs: Pointer to the opened file
+ * graph: Pointer to the graph object
+ *
+ * Returns 1 if the fingerprints match, 0 otherwise
+ */
+int cga_pairs_match(const cga_pairs_t *pairs, const cga_graph_t *graph);
+
+/**
+ * Unmaps a file opened with cga_pairs_open().
+ *
+ * Arguments:
+ * pairs: Pointer to the opened file
+ */
+void cga_pairs_close(cga_pairs_t *pairs);
+
+/**
+ * Converts a binary result file in the CSV of cga_graph_analysis, with the same header and rows
+ * (in the symmetric mode each record gives both its rows, as the analysis does).
+ *
+ * Arguments:
+ * path: Path of the binary result file
+ * csv_path: Path of the CSV file to write. The folders forming the path must already exist
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory,
+ * NRPERM or WRFORMAT as cga_pairs_open, NWPERM if the CSV file can't be written.
+ */
+cga_status_t cga_pairs_to_csv(const char *path, const char *csv_path);
+
+#endif
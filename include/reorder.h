@@ -0,0 +1,75 @@
+#ifndef REORDER_H_lkjhgfdsapoiuytrewqmnbvcx
+#define REORDER_H_lkjhgfdsapoiuytrewqmnbvcx
+
+#include <stdint.h>
+#include "graph.h"
+#include "hashtable.h"
+#include "status.h"
+
+/**
+ * Relabeling of the vertices of a graph, to improve the locality of the searches.
+ * The loader gives the vertex_ids in order of first appearance in the as-rel file, so the
+ * neighbors of a vertex are scattered over the whole graph and each hop of a search touches
+ * far away parts of offsets, of the visited set and of the reachability tables. Renumbering the
+ * vertices so that neighbors get close vertex_ids keeps those accesses in fewer cache lines.
+ * The as_numbers move together with their vertices, so the output of the analyses still reports
+ * the original as_numbers; only the order of the rows can change.
+ * The orders are:
+ * CGA_ORDER_BFS: breadth first order from the vertex with the highest degree of each
+ *                connected component, so the large providers and their neighbors come first
+ * CGA_ORDER_RCM: reverse Cuthill-McKee, a breadth first order from a vertex of minimum degree
+ *                visiting the neighbors by increasing degree, reversed. It minimizes the
+ *                distance between the vertex_ids of neighbors (the bandwidth of the adjacency matrix)
+ * CGA_ORDER_DEGREE: by decreasing degree
+ * CGA_ORDER_CONE: by decreasing size of the customer cone (see cone.h), i.e. from the top of the
+ *                 hierarchy to the stub ASes, the degree breaking the ties
+ */
+typedef enum _cga_order {
+    CGA_ORDER_BFS, CGA_ORDER_RCM, CGA_ORDER_DEGREE, CGA_ORDER_CONE
+} cga_order_t;
+
+/**
+ * Computes the new vertex_ids of the vertices of a graph for the given order.
+ *
+ * Arguments:
+ * graph: Pointer to the graph object
+ * order: The order of the vertices
+ * perm: Array of cga_graph_vcount(graph) elements where the new vertex_id of each vertex is stored,
+ *       perm[v] for the vertex v
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory.
+ */
+cga_status_t cga_graph_order(const cga_graph_t *graph, cga_order_t order, uint32_t *perm);
+
+/**
+ * Renumbers the vertices of a graph: the vertex v becomes perm[v]. The adjacency lists, the
+ * as_numbers and the as_number index of the graph are permuted together, and so are all the
+ * vertex_ids stored in ht, if given (also the ones of as_numbers without relationships, e.g.
+ * preloaded from a saved hashtable).
+ * A graph opened from a snapshot gets its own copy of the arrays and releases the mapping.
+ * Anything computed on the old vertex_ids (e.g. the customer cones) must be computed again.
+ *
+ * Arguments:
+ * graph: Pointer to the graph object
+ * ht: Pointer to the hashtable mapping the as_numbers to the vertex_ids of the graph, or NULL
+ * perm: The new vertex_ids, a permutation of [0, cga_graph_vcount(graph))
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory
+ * (the graph is left unchanged), WRFORMAT if perm is not a permutation.
+ */
+cga_status_t cga_graph_permute(cga_graph_t *graph, cga_hashtable_t *ht, const uint32_t *perm);
+
+/**
+ * Renumbers the vertices of a graph in the given order, with cga_graph_order and cga_graph_permute.
+ * Call it right after loading the graph, before any analysis.
+ *
+ * Arguments:
+ * graph: Pointer to the graph object
+ * ht: Pointer to the hashtable mapping the as_numbers to the vertex_ids of the graph, or NULL
+ * order: The order of the vertices
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory.
+ */
+cga_status_t cga_graph_reorder(cga_graph_t *graph, cga_hashtable_t *ht, cga_order_t order);
+
+#endif
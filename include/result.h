@@ -0,0 +1,149 @@
+#ifndef RESULT_H_plmoknijbuhvygctfxrdzeswaq
+#define RESULT_H_plmoknijbuhvygctfxrdzeswaq
+
+#include <stddef.h>
+#include <stdint.h>
+#include "graph.h"
+#include "pairs.h"
+#include "status.h"
+
+#define CGA_RESULT_MAGIC "CGARES"
+#define CGA_RESULT_VERSION 1
+#define CGA_RESULT_EXT "cgr"  // extension of the indexed result files
+
+/**
+ * Header of an indexed result file. After the header there are, each one aligned to 8 bytes and
+ * at the given offset from the start of the file,
+ * - records: count cga_pair_record_t sorted by <from, to>, so the records of each source are
+ *   contiguous (source-major order)
+ * - sources: nsources + 1 cga_result_source_t sorted by as_number, the last one being a sentinel
+ *   whose first is count
+ * so the file can be mapped and queried in place. flags and fingerprint are the ones of the
+ * binary result files it has been built from (see pairs.h).
+ * All the values are stored in the byte order of the machine that wrote the file.
+ */
+typedef struct _cga_result_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t record_size;
+    uint32_t flags;
+    uint64_t fingerprint;
+    uint32_t vcount;
+    uint32_t ecount;
+    uint64_t count;
+    uint64_t nsources;
+    uint64_t records_off;
+    uint64_t sources_off;
+    uint64_t file_size;
+} cga_result_header_t;
+
+/**
+ * Entry of the offset table of an indexed result file: the records of the source asn are
+ * records[first] ... records[next entry's first - 1].
+ */
+typedef struct _cga_result_source {
+    uint32_t asn;
+    uint32_t reserved;
+    uint64_t first;
+} cga_result_source_t;
+
+/**
+ * Indexed result file opened for reading.
+ *
+ * Fields:
+ * header: Pointer to the header of the file
+ * records: Pointer to the sorted records
+ * sources: Pointer to the offset table
+ * mapping, mapping_size: The memory mapped file
+ */
+typedef struct _cga_result {
+    const cga_result_header_t *header;
+    const cga_pair_record_t *records;
+    const cga_result_source_t *sources;
+    void *mapping;
+    size_t mapping_size;
+} cga_result_t;
+
+/**
+ * Builds an indexed result file from the binary result files of a run of cga_graph_analysis
+ * (one per thread, or the consolidated one). Each input file is sorted in place by <from, to>,
+ * one thread per file, then all of them are merged (k-way merge) in the indexed file.
+ * The file is written with a temporary name and then renamed, so processes opening it while it
+ * is being built never see a partial file.
+ *
+ * Arguments:
+ * paths: Array of the paths of the binary result files
+ * npaths: Number of elements of paths
+ * path: Path of the indexed result file. The folders forming the path must already exist
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory,
+ * NRPERM if an input file can't be opened, WRFORMAT if an input file is not a binary result file
+ * or the files come from different graphs or options, NWPERM if the file can't be written.
+ */
+cga_status_t cga_result_build(const char *const *paths, unsigned int npaths, const char *path);
+
+/**
+ * Opens an indexed result file, mapping it in memory.
+ * Every file opened by this function should be closed with cga_result_close().
+ *
+ * Arguments:
+ * result: Pointer to an uninitialized cga_result_t
+ * path: Path of the file
+ *
+ * Returns SUCCESS if the operation completed without errors, NRPERM if the file can't be opened,
+ * WRFORMAT if the file is not an indexed result file of this version or its offset table is
+ * inconsistent.
+ */
+cga_status_t cga_result_open(cga_result_t *result, const char *path);
+
+/**
+ * Unmaps a file opened with cga_result_open().
+ *
+ * Arguments:
+ * result: Pointer to the opened file
+ */
+void cga_result_close(cga_result_t *result);
+
+/**
+ * Checks that the results have been computed on the given graph.
+ *
+ * Arguments:
+ * result: Pointer to the opened file
+ * graph: Pointer to the graph object
+ *
+ * Returns 1 if the fingerprints match, 0 otherwise
+ */
+int cga_result_match(const cga_result_t *result, const cga_graph_t *graph);
+
+/**
+ * Gives the records of a source, sorted by the as_number of the target.
+ * In the symmetric mode (CGA_PAIRS_SYMMETRIC) each pair is stored only once, under one of its two
+ * autonomous systems: use cga_result_find to look up a single pair.
+ *
+ * Arguments:
+ * result: Pointer to the opened file
+ * from: The as_number of the source
+ * count: Pointer where the number of records is stored
+ *
+ * Returns a pointer to the first record of the source, NULL (and count 0) if there are none
+ */
+const cga_pair_record_t *cga_result_source(const cga_result_t *result, uint32_t from, size_t *count);
+
+/**
+ * Looks up the statistics of the paths from an autonomous system to another one, with two binary
+ * searches: one in the offset table and one among the records of the source.
+ * In the symmetric mode the pair is looked up in both directions; a record found in the opposite
+ * direction is reversed (costs negated) as the CSV conversion does.
+ *
+ * Arguments:
+ * result: Pointer to the opened file
+ * from: The as_number of the starting autonomous system
+ * to: The as_number of the target autonomous system
+ * record: Pointer where the record is copied
+ *
+ * Returns 1 if the pair has been found, 0 if there are no results for it
+ */
+int cga_result_find(const cga_result_t *result, uint32_t from, uint32_t to, cga_pair_record_t *record);
+
+#endif
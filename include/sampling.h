@@ -0,0 +1,168 @@
+#ifndef SAMPLING_H_wsxedcrfvtgbyhnujmikolpq
+#define SAMPLING_H_wsxedcrfvtgbyhnujmikolpq
+
+#include <igraph/igraph.h>
+#include <stdint.h>
+#include "as_relationship.h"
+#include "graph.h"
+#include "status.h"
+
+/**
+ * Monte Carlo estimation of the path statistics, for the pairs of ASes whose paths are too many
+ * to be enumerated.
+ * Each sample is a random simple walk from the starting vertex that, at each step, picks one of
+ * the hops that can still lead to the target uniformly at random. A walk reaching the target
+ * has a weight equal to the product of the number of choices it had at each step, the inverse
+ * of its probability, so the average weight is an unbiased estimate of the number of paths
+ * (Knuth's estimator of the size of a search tree). Sums over the paths (lengths, costs) are
+ * estimated in the same way, and the averages as ratios of two estimates.
+ * The samples are split in batches of CGA_MC_BATCH walks, each one with its own random stream
+ * derived from the seed, and the batches are merged in order: the results only depend on the
+ * seed and on the number of samples, not on the number of threads.
+ */
+
+#define CGA_MC_BATCH 1024
+#define CGA_MC_MAX_LENGTH 64  // longer paths are counted in the last bucket of the histograms
+
+/**
+ * Options of the Monte Carlo estimations. Initialize them with cga_mc_opts_init, then change
+ * only the fields needed.
+ *
+ * Fields:
+ * samples: The number of random walks. Default 10000
+ * seed: The seed of the random streams. Default 1
+ * nthreads: The number of threads sampling the walks. Default 1
+ * z: The quantile of the normal distribution used for the confidence intervals. Default 1.96 (95%)
+ * max_hops: The maximum length of the walks, 0 if not limited. Default 0
+ */
+typedef struct _cga_mc_opts {
+    uint64_t samples;
+    uint64_t seed;
+    unsigned int nthreads;
+    double z;
+    long max_hops;
+} cga_mc_opts_t;
+
+/**
+ * An estimated value with its confidence interval [low, high].
+ */
+typedef struct _cga_mc_estimate {
+    double value;
+    double low;
+    double high;
+} cga_mc_estimate_t;
+
+/**
+ * Estimated statistics of the valley free paths between two nodes.
+ *
+ * Fields:
+ * samples: The number of random walks
+ * hits: The number of walks that reached the target
+ * paths: The estimated number of valley free paths
+ * avg_length: The estimated average length of the paths
+ * avg_cost: The estimated average cost of the paths
+ * length_min, length_max, cost_min, cost_max: Minimum and maximum among the sampled paths (not
+ *                                             estimates: the real bounds can be wider)
+ * length_hist: The estimated number of paths of each length
+ * cost_hist: The estimated number of paths of each cost, cost_hist[CGA_MC_MAX_LENGTH + c] for the cost c
+ */
+typedef struct _cga_mc_result {
+    uint64_t samples;
+    uint64_t hits;
+    cga_mc_estimate_t paths;
+    cga_mc_estimate_t avg_length;
+    cga_mc_estimate_t avg_cost;
+    int length_min;
+    int length_max;
+    int cost_min;
+    int cost_max;
+    double length_hist[CGA_MC_MAX_LENGTH + 1];
+    double cost_hist[2 * CGA_MC_MAX_LENGTH + 1];
+} cga_mc_result_t;
+
+/**
+ * Estimated degree of freedom of the paths between two nodes (see cga_degree_freedom_path).
+ *
+ * Fields:
+ * samples: The number of random walks
+ * hits: The number of walks that reached the target
+ * vfree: The estimated number of valley free simple paths
+ * novfree: The estimated number of not valley free simple paths
+ * ratio: The estimated degree of freedom, vfree / novfree
+ */
+typedef struct _cga_mc_freedom {
+    uint64_t samples;
+    uint64_t hits;
+    cga_mc_estimate_t vfree;
+    cga_mc_estimate_t novfree;
+    cga_mc_estimate_t ratio;
+} cga_mc_freedom_t;
+
+/**
+ * Sets the options to their default values.
+ *
+ * Arguments:
+ * opts: Pointer to the options
+ */
+void cga_mc_opts_init(cga_mc_opts_t *opts);
+
+/**
+ * Estimates the number, the lengths and the costs of the valley free paths between two nodes.
+ * The walks only take the hops from which the target can still be reached (see
+ * cga_dfs_ctx_set_target), so most of them reach it.
+ *
+ * Arguments:
+ * graph: Pointer to the graph object
+ * ctx: Pointer to a DFS context of the graph, used for its reachability table. If NULL a context
+ *      is created and destroyed by this function
+ * from: The starting vertex_id
+ * to: The ending vertex_id
+ * opts: Pointer to the options. If NULL the default options are used
+ * res: Pointer where the estimates are stored
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory.
+ */
+cga_status_t cga_mc_path_stats(cga_graph_t *graph, cga_dfs_ctx_t *ctx, igraph_integer_t from, igraph_integer_t to, const cga_mc_opts_t *opts, cga_mc_result_t *res);
+
+/**
+ * Estimates the number of valley free and not valley free simple paths between two nodes, and
+ * their ratio, the degree of freedom of the paths.
+ *
+ * Arguments:
+ * graph: Pointer to the graph object
+ * from: The starting vertex_id
+ * to: The ending vertex_id
+ * opts: Pointer to the options. If NULL the default options are used
+ * res: Pointer where the estimates are stored
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory.
+ */
+cga_status_t cga_mc_degree_freedom(cga_graph_t *graph, igraph_integer_t from, igraph_integer_t to, const cga_mc_opts_t *opts, cga_mc_freedom_t *res);
+
+/**
+ * Approximate version of cga_graph_analysis: for each pair of nodes with at least a valley free
+ * path, the statistics of the paths are estimated with cga_mc_path_stats instead of enumerating
+ * the paths. The pairs are distributed among nthreads threads (each pair is sampled by a single
+ * thread, opts->nthreads is ignored) and the output files follow the same conventions of
+ * cga_graph_analysis. The seed of each pair is derived from opts->seed and the pair, so the output
+ * doesn't depend on the number of threads.
+ * The header <from, to, paths, paths low, paths high, avg length, avg length low, avg length high,
+ * avg cost, avg cost low, avg cost high, min length, max length, min cost, max cost, hits>
+ * gives for each pair the estimates with their confidence intervals, the bounds observed in the
+ * sampled paths and the number of walks that reached the target.
+ *
+ * Arguments:
+ * graph: Pointer to the graph object
+ * nthreads: The number of threads used to analyze the graph. The given value must be
+ *           at last greater or equal to 1
+ * filename: Part of the name used to compose the name of the output file. It should not have
+ *           the extension and can be a path (in this case the folders that compose the path
+ *           must already exists)
+ * opts: Pointer to the options. If NULL the default options are used
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory,
+ * NWPERM if an output file can't be written.
+ */
+cga_status_t cga_graph_analysis_mc(cga_graph_t *graph, unsigned int nthreads, char *filename, const cga_mc_opts_t *opts);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef SCHEDULER_H_zmxncbvlaksjdhfgqpwoeiru
+#define SCHEDULER_H_zmxncbvlaksjdhfgqpwoeiru
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct _cga_sched cga_sched_t;
+
+/**
+ * Creates a work-stealing scheduler that distributes the given tasks among nworkers threads.
+ * Tasks are sorted by decreasing weight (an estimate of their cost) and dealt round robin to
+ * the workers, so that each worker starts from the largest tasks. A worker that runs out of
+ * tasks steals the largest task left in the queue of another worker.
+ * Every scheduler created by this function should be destroyed with cga_sched_destroy().
+ *
+ * Arguments:
+ * nworkers: The number of workers that will ask for tasks. It must be at least 1
+ * tasks: Array of task identifiers (e.g. vertex_ids)
+ * weights: Array of estimated costs of the tasks, in the same order of tasks. If NULL all the
+ *          tasks have the same cost and keep their order
+ * ntasks: The number of tasks
+ *
+ * Returns a pointer to the newly created scheduler, NULL if there's not enough memory
+ */
+cga_sched_t *cga_sched_init(unsigned int nworkers, const uint32_t *tasks, const uint64_t *weights, size_t ntasks);
+
+/**
+ * Destroys a scheduler object.
+ *
+ * Arguments:
+ * sched: Pointer to the (previously initialized) scheduler to destroy
+ */
+void cga_sched_destroy(cga_sched_t *sched);
+
+/**
+ * Gives to a worker its next task: the largest task of its own queue or, if the queue is
+ * empty, a task stolen from the queue of another worker.
+ * This function is thread safe, each worker must use its own worker index.
+ *
+ * Arguments:
+ * sched: Pointer to the scheduler object
+ * worker: The index of the worker, in [0, nworkers)
+ * task: Pointer where the task identifier is stored
+ *
+ * Returns 1 if a task has been stored in task, 0 if all the tasks have been assigned
+ */
+int cga_sched_next(cga_sched_t *sched, unsigned int worker, uint32_t *task);
+
+#endif
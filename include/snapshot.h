@@ -0,0 +1,65 @@
+#ifndef SNAPSHOT_H_lkjhgfdsapoiuytrewqmnbvc
+#define SNAPSHOT_H_lkjhgfdsapoiuytrewqmnbvc
+
+#include <stdint.h>
+#include "graph.h"
+#include "status.h"
+
+#define CGA_SNAPSHOT_MAGIC "CGASNAP"
+#define CGA_SNAPSHOT_VERSION 1
+
+/**
+ * Header of a binary snapshot file. The file is laid out so that it can be mapped in memory and
+ * used as a cga_graph_t without any parsing: after the header there are, each one aligned to 8
+ * bytes and at the given offset from the start of the file,
+ * - offsets: vcount + 1 uint32_t, the CSR offsets
+ * - adj: ecount uint32_t, the packed neighbors with their relationship (see CGA_ADJ_PACK)
+ * - labels: vcount uint64_t, the as_number of each vertex
+ * - index: vcount cga_asn_index_t, the as_numbers sorted with their vertex_id
+ * All the values are stored in the byte order of the machine that wrote the file.
+ */
+typedef struct _cga_snapshot_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t vcount;
+    uint32_t ecount;
+    uint64_t offsets_off;
+    uint64_t adj_off;
+    uint64_t labels_off;
+    uint64_t index_off;
+    uint64_t file_size;
+} cga_snapshot_header_t;
+
+/**
+ * Writes the graph in a binary snapshot file.
+ * The file is written with a temporary name and then renamed, so processes opening the snapshot
+ * while it is being written never see a partial file.
+ *
+ * Arguments:
+ * graph: Pointer to the graph object
+ * path: Path of the snapshot file. The folders forming the path must already exist
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory,
+ * NWPERM if the file can't be written.
+ */
+cga_status_t cga_snapshot_save(const cga_graph_t *graph, const char *path);
+
+/**
+ * Opens a binary snapshot file written by cga_snapshot_save, mapping it in memory.
+ * The arrays of the graph point directly into the mapped (read-only, shared) pages, so opening
+ * the snapshot only costs a validation pass over the pages and many processes opening the same
+ * file share its memory.
+ * The graph has an as_number index, so cga_graph_find() is a binary search.
+ * The graph must be destroyed with cga_graph_destroy(), which unmaps the file.
+ *
+ * Arguments:
+ * graph: Pointer to an uninitialized graph object
+ * path: Path of the snapshot file
+ *
+ * Returns SUCCESS if the operation completed without errors, NRPERM if the file can't be opened,
+ * WRFORMAT if the file is not a valid snapshot of this version or its arrays are inconsistent.
+ */
+cga_status_t cga_snapshot_open(cga_graph_t *graph, const char *path);
+
+#endif
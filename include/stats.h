@@ -0,0 +1,170 @@
+#ifndef STATS_H_rfvtgbyhnujmikolpqazwsxedc
+#define STATS_H_rfvtgbyhnujmikolpqazwsxedc
+
+#include <stdint.h>
+#include <stdio.h>
+#include "status.h"
+
+/**
+ * Counters of the work done by the library, kept by every thread in its own slot and summed
+ * only when they are read, so counting is a plain add on a cache line owned by the thread.
+ * CGA_STAT_SOURCES: tasks (source or target vertices) completed by the all-pairs analyses
+ * CGA_STAT_PAIRS: pairs of vertices analyzed, i.e. whose paths have been searched: the pairs left
+ *                 out because a vertex is isolated or there's no valley free path between them
+ *                 are not counted. A pair is counted once also when the symmetric mode writes
+ *                 both its rows
+ * CGA_STAT_EXPANDED: vertices pushed on the stack by the depth first searches
+ * CGA_STAT_PRUNED: branches of the depth first searches cut because they are not valley free or
+ *                  can't reach the target through a valley free path
+ * CGA_STAT_PATHS: paths found by the depth first searches
+ * CGA_STAT_BYTES: bytes written by the cga_writer_t
+ */
+typedef enum _cga_stat {
+    CGA_STAT_SOURCES, CGA_STAT_PAIRS, CGA_STAT_EXPANDED, CGA_STAT_PRUNED, CGA_STAT_PATHS, CGA_STAT_BYTES,
+    CGA_STAT_COUNT
+} cga_stat_t;
+
+/**
+ * Phases whose wall time is measured.
+ * CGA_PHASE_LOAD: reading and parsing the as-rel files and opening the snapshots
+ * CGA_PHASE_BUILD: building the CSR graph
+ * CGA_PHASE_ANALYZE: running the analyses
+ * CGA_PHASE_WRITE: writing the output files (overlapping the analysis, as they are written
+ *                  while it runs)
+ */
+typedef enum _cga_phase {
+    CGA_PHASE_LOAD, CGA_PHASE_BUILD, CGA_PHASE_ANALYZE, CGA_PHASE_WRITE,
+    CGA_PHASE_COUNT
+} cga_phase_t;
+
+/**
+ * Slot of the counters of a thread, on its own cache line. Only the owner thread writes it.
+ */
+typedef struct _cga_stats_slot {
+    uint64_t counters[CGA_STAT_COUNT];
+    struct _cga_stats_slot *next;
+} __attribute__((aligned(64))) cga_stats_slot_t;
+
+/**
+ * Aggregated statistics, as read by cga_stats_read.
+ *
+ * Fields:
+ * counters: The sum of each counter over all the threads
+ * phases: The wall time in seconds of each phase, i.e. the time during which at least a
+ *         thread was in the phase
+ * elapsed: The seconds since the statistics started (the first use or the last reset)
+ */
+typedef struct _cga_stats {
+    uint64_t counters[CGA_STAT_COUNT];
+    double phases[CGA_PHASE_COUNT];
+    double elapsed;
+} cga_stats_t;
+
+extern __thread cga_stats_slot_t *cga_stats_tls;
+
+/**
+ * Creates the slot of the calling thread. Called by cga_stats_add the first time a thread
+ * counts something. When the thread ends its counts are added to a total of the ended threads,
+ * so they are not lost, and the slot is freed.
+ *
+ * Returns the slot of the thread
+ */
+cga_stats_slot_t *cga_stats_register(void);
+
+/**
+ * Adds n to a counter of the calling thread.
+ *
+ * Arguments:
+ * stat: The counter
+ * n: The value to add
+ */
+static inline void cga_stats_add(cga_stat_t stat, uint64_t n) {
+    cga_stats_slot_t *slot = cga_stats_tls;
+    if (slot == NULL) slot = cga_stats_register();
+    // a single writer, the atomic store only makes the value safe to read from other threads
+    __atomic_store_n(&slot->counters[stat], slot->counters[stat] + n, __ATOMIC_RELAXED);
+}
+
+/**
+ * Marks the calling thread as entering a phase. Calls to begin and end can be nested and made by
+ * many threads: the wall time is counted from the first begin to the last end.
+ *
+ * Arguments:
+ * phase: The phase
+ */
+void cga_stats_phase_begin(cga_phase_t phase);
+
+/**
+ * Marks the calling thread as leaving a phase entered with cga_stats_phase_begin.
+ *
+ * Arguments:
+ * phase: The phase
+ */
+void cga_stats_phase_end(cga_phase_t phase);
+
+/**
+ * Reads the statistics, summing the counters of all the threads. It can be called while the
+ * threads are counting: each counter is exact at some moment during the read.
+ *
+ * Arguments:
+ * stats: Pointer where the statistics are stored
+ */
+void cga_stats_read(cga_stats_t *stats);
+
+/**
+ * Sets all the counters and the phase times to zero and restarts the elapsed time.
+ * Call it when no thread is counting, e.g. between two analyses.
+ */
+void cga_stats_reset(void);
+
+/**
+ * Gives the name of a counter, as used in the JSON report (e.g. "pairs").
+ *
+ * Arguments:
+ * stat: The counter
+ *
+ * Returns the name
+ */
+const char *cga_stat_name(cga_stat_t stat);
+
+/**
+ * Gives the name of a phase, as used in the JSON report (e.g. "analyze").
+ *
+ * Arguments:
+ * phase: The phase
+ *
+ * Returns the name
+ */
+const char *cga_phase_name(cga_phase_t phase);
+
+/**
+ * Writes the statistics as a JSON object:
+ * {"elapsed": s, "counters": {"sources": n, ...}, "phases": {"load": s, ...}}
+ *
+ * Arguments:
+ * stats: Pointer to the statistics
+ * out: The stream to write in
+ */
+void cga_stats_print_json(const cga_stats_t *stats, FILE *out);
+
+/**
+ * Starts a thread that every interval seconds writes a line with the progress of the work:
+ * the counters, and the pairs per second since the previous line.
+ * Only one reporter can run at a time.
+ *
+ * Arguments:
+ * interval: The seconds between two lines
+ * out: The stream to write in, e.g. stderr
+ *
+ * Returns SUCCESS if the operation completed without errors, DPLKTKEY if a reporter is already
+ * running, NOMEM if the thread can't be started.
+ */
+cga_status_t cga_stats_reporter_start(double interval, FILE *out);
+
+/**
+ * Stops the reporter started by cga_stats_reporter_start, which writes a last line.
+ * It does nothing if no reporter is running.
+ */
+void cga_stats_reporter_stop(void);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef VISITED_H_vbnmqwertyasdfzxcvhjklpo
+#define VISITED_H_vbnmqwertyasdfzxcvhjklpo
+
+#include <stdint.h>
+#include "status.h"
+
+/**
+ * Dense set of vertex_ids used to mark the visited vertices during a search.
+ * Each vertex has a stamp: the vertex is in the set iff its stamp is equal to the current epoch,
+ * so the whole set is cleared in O(1) by moving to the next epoch. Insertions, deletions and
+ * lookups are a single array access and never allocate memory.
+ * For sparse sets of arbitrary elements use cga_hashset_t.
+ * The fields must be considered private.
+ */
+typedef struct _cga_visited {
+    uint32_t *stamp;
+    uint32_t epoch;
+    uint32_t size;
+} cga_visited_t;
+
+/**
+ * Initializes an empty visited set for the vertex_ids in [0, size).
+ * Every visited set initialized by this function should be destroyed with cga_vs_destroy().
+ * 
+ * Arguments:
+ * vs: Pointer to an uninitialized visited set
+ * size: The number of vertices of the graph
+ * 
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory.
+ */
+cga_status_t cga_vs_init(cga_visited_t *vs, uint32_t size);
+
+/**
+ * Frees the memory used by the visited set.
+ * 
+ * Arguments:
+ * vs: Pointer to the (previously initialized) visited set to destroy
+ */
+void cga_vs_destroy(cga_visited_t *vs);
+
+/**
+ * Deletes all the elements from the visited set in O(1) (amortized).
+ * 
+ * Arguments:
+ * vs: Pointer to the visited set to clear
+ */
+void cga_vs_clear(cga_visited_t *vs);
+
+/**
+ * Inserts the vertex v in the visited set.
+ */
+static inline void cga_vs_insert(cga_visited_t *vs, uint32_t v) {
+    vs->stamp[v] = vs->epoch;
+}
+
+/**
+ * Deletes the vertex v from the visited set.
+ */
+static inline void cga_vs_delete(cga_visited_t *vs, uint32_t v) {
+    vs->stamp[v] = 0;  // the epoch is never 0
+}
+
+/**
+ * Returns 1 if the vertex v is in the visited set, 0 otherwise
+ */
+static inline int cga_vs_contains(const cga_visited_t *vs, uint32_t v) {
+    return vs->stamp[v] == vs->epoch;
+}
+
+#endif
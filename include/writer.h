@@ -0,0 +1,157 @@
+#ifndef WRITER_H_qazwsxedcrfvtgbyhnujmikolp
+#define WRITER_H_qazwsxedcrfvtgbyhnujmikolp
+
+#include <stddef.h>
+#include <stdint.h>
+#include "status.h"
+
+#define CGA_WRITER_BUFSIZE (1 << 20)  // 1MB, so each write(2) moves a large block
+#define CGA_WRITER_ROOM 64            // room reserved by each formatting function
+
+/**
+ * Buffered output sink of a single thread, used by the analyses to write their rows.
+ * The rows are formatted directly into a large buffer with hand-written integer and fixed-point
+ * formatting, without the parsing of the printf format strings and the locking of the FILE
+ * streams, and the buffer is handed to the kernel with write(2) only when it is full.
+ * A write error is kept in the writer and returned by cga_writer_flush and cga_writer_close,
+ * so the rows can be written without checking each call.
+ *
+ * Fields:
+ * fd: The file descriptor of the output file
+ * buf: The buffer
+ * len: The number of bytes in the buffer
+ * size: The size of the buffer
+ * written: The size of the file, i.e. the bytes already written out of the buffer
+ * status: SUCCESS, or NWPERM if a write failed
+ */
+typedef struct _cga_writer {
+    int fd;
+    char *buf;
+    size_t len;
+    size_t size;
+    uint64_t written;
+    cga_status_t status;
+} cga_writer_t;
+
+/**
+ * Creates (or truncates) a file and prepares a writer for it.
+ * Every writer opened by this function should be closed with cga_writer_close().
+ *
+ * Arguments:
+ * writer: Pointer to an uninitialized writer
+ * path: Path of the file. The folders forming the path must already exist
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory,
+ * NWPERM if the file can't be created.
+ */
+cga_status_t cga_writer_open(cga_writer_t *writer, const char *path);
+
+/**
+ * Opens an existing file to go on writing it from offset: the content after offset (e.g. the
+ * rows written after the last checkpoint of a crashed run) is discarded. If the file doesn't
+ * exist it is created, and offset must be 0.
+ * Every writer opened by this function should be closed with cga_writer_close().
+ *
+ * Arguments:
+ * writer: Pointer to an uninitialized writer
+ * path: Path of the file
+ * offset: The number of bytes of the file to keep
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory,
+ * NWPERM if the file can't be opened or truncated, WRFORMAT if the file is shorter than offset.
+ */
+cga_status_t cga_writer_resume(cga_writer_t *writer, const char *path, uint64_t offset);
+
+/**
+ * Writes the content of the buffer in the file.
+ *
+ * Arguments:
+ * writer: Pointer to the writer
+ *
+ * Returns SUCCESS if all the writes so far completed without errors, NWPERM otherwise.
+ */
+cga_status_t cga_writer_flush(cga_writer_t *writer);
+
+/**
+ * Flushes the buffer and waits for the file to be written on the disk (fsync), so that its
+ * first writer->written bytes survive a crash.
+ *
+ * Arguments:
+ * writer: Pointer to the writer
+ *
+ * Returns SUCCESS if all the writes so far completed without errors, NWPERM otherwise.
+ */
+cga_status_t cga_writer_sync(cga_writer_t *writer);
+
+/**
+ * Flushes the buffer, closes the file and frees the buffer.
+ *
+ * Arguments:
+ * writer: Pointer to the writer
+ *
+ * Returns SUCCESS if all the writes completed without errors, NWPERM otherwise.
+ */
+cga_status_t cga_writer_close(cga_writer_t *writer);
+
+/**
+ * Appends len bytes of data.
+ *
+ * Arguments:
+ * writer: Pointer to the writer
+ * data: The bytes to write
+ * len: The number of bytes
+ */
+void cga_writer_write(cga_writer_t *writer, const char *data, size_t len);
+
+/**
+ * Appends a NUL terminated string.
+ *
+ * Arguments:
+ * writer: Pointer to the writer
+ * str: The string to write
+ */
+void cga_writer_puts(cga_writer_t *writer, const char *str);
+
+/**
+ * Appends an unsigned integer in base 10, as printf("%llu").
+ *
+ * Arguments:
+ * writer: Pointer to the writer
+ * value: The value to write
+ */
+void cga_writer_uint(cga_writer_t *writer, uint64_t value);
+
+/**
+ * Appends a signed integer in base 10, as printf("%lld").
+ *
+ * Arguments:
+ * writer: Pointer to the writer
+ * value: The value to write
+ */
+void cga_writer_int(cga_writer_t *writer, int64_t value);
+
+/**
+ * Appends a real number with a fixed number of decimals, with the same output of
+ * printf("%.*f", decimals, value).
+ *
+ * Arguments:
+ * writer: Pointer to the writer
+ * value: The value to write
+ * decimals: The number of decimals, at most 9
+ */
+void cga_writer_fixed(cga_writer_t *writer, double value, unsigned int decimals);
+
+/**
+ * Appends a single character.
+ *
+ * Arguments:
+ * writer: Pointer to the writer
+ * c: The character to write
+ */
+static inline void cga_writer_putc(cga_writer_t *writer, char c) {
+    if (writer->len == writer->size)
+        cga_writer_flush(writer);
+    writer->buf[writer->len++] = c;
+}
+
+#endif
@@ -3,11 +3,26 @@
 #include <igraph/igraph.h>
 #include <limits.h>
 #include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "checkpoint.h"
+#include "graph.h"
+#include "hash.h"
 #include "hashset.h"
 #include "hashtable.h"
+#include "output.h"
+#include "pairs.h"
+#include "result.h"
+#include "scheduler.h"
+#include "stats.h"
+#include "visited.h"
+#include "writer.h"
 
 typedef struct _as_rel {
     unsigned long as1;
@@ -17,71 +32,297 @@ typedef struct _as_rel {
     int relation;
 } as_rel_t;
 
+#define PARSE_MIN_CHUNK (1 << 20)  // chunks smaller than 1MB are not worth a thread
+#define PARSE_MAX_THREADS 16
+
+/**
+ * Newline aligned part of an as-rel file, parsed by a thread into the array rels.
+ */
+typedef struct _parse_chunk {
+    pthread_t t_id;
+    const char *begin;
+    const char *end;
+    as_rel_t *rels;
+    size_t nrels;
+    size_t size;
+    size_t malformed;
+} parse_chunk_t;
+
+/**
+ * Buffers of the breadth first search over the product graph <vertex, valley free state>.
+ * The entry 2 * v + state refers to the vertex v reached with the automaton in the given state.
+ */
+typedef struct _vf_bfs {
+    int32_t *dist;
+    uint64_t *count;
+    int *cost_min;
+    int *cost_max;
+    uint32_t *queue;
+    uint32_t qlen;
+} vf_bfs_t;
+
+/**
+ * State of the iterative valley free DFS. The stack has a frame for each vertex of curr_path:
+ * cursor is the index in graph->adj of the next neighbor to explore, dfa_state the state of
+ * the valley free automaton when the vertex has been reached and cost the cost of the path up
+ * to the vertex. The length of the path up to the vertex is the index of its frame, so both are
+ * known in O(1) when a path reaches its target.
+ * reach[v] has the bit s set if target can be reached from v with the automaton in the state s;
+ * queue is the queue of the breadth first search that computes it.
+ */
+struct _cga_dfs_ctx {
+    cga_graph_t *graph;
+    cga_visited_t used_nodes;
+    igraph_vector_int_t curr_path;
+    uint32_t *cursor;
+    int *dfa_state;
+    int *cost;
+    uint8_t *reach;
+    uint32_t *queue;
+    igraph_integer_t target;
+    cga_dfs_limits_t limits;
+};
+
+/**
+ * State of the recursive valley free DFS shared by all the levels of the recursion.
+ */
+typedef struct _rec_search {
+    cga_graph_t *graph;
+    const cga_cones_t *cones;
+    igraph_integer_t target;
+    long max_hops;
+    uint64_t budget;
+    uint64_t expanded;
+    int truncated;
+    igraph_vector_int_t curr_path;
+    cga_visited_t used_nodes;
+    cga_path_visitor_t visitor;
+    void *arg;
+} rec_search_t;
+
+#define DFS_SPLIT_POLL 64  // expansions between two checks of the split pool
+
+/**
+ * Subtree of the valley free DFS: the paths extending prefix (the vertices prefix[0..length])
+ * through the neighbors of its last vertex with index in [lo, hi) inside graph->adj. state and
+ * cost are the state of the automaton and the cost of the prefix.
+ */
+typedef struct _dfs_subtree {
+    igraph_integer_t *prefix;
+    long length;
+    int state;
+    int cost;
+    uint32_t lo;
+    uint32_t hi;
+} dfs_subtree_t;
+
+/**
+ * Subtrees of a single search shared by many threads. The searches poll hungry every
+ * DFS_SPLIT_POLL expansions, and when some thread is waiting they move the unexplored neighbors
+ * of their shallowest frame into tasks. hungry and halt are changed under lock but also read
+ * without it, so they are accessed atomically. halt is set to CGA_DFS_STOPPED when a visitor stops the
+ * search, to CGA_DFS_TRUNCATED when the shared budget runs out.
+ */
+typedef struct _dfs_split {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    dfs_subtree_t *tasks;
+    size_t ntasks;
+    size_t size;
+    unsigned int active;  // threads exploring a subtree
+    int hungry;           // threads waiting for a subtree
+    int halt;
+    int truncated;
+    uint64_t budget;
+    uint64_t expanded;
+} dfs_split_t;
+
+struct split_tinfo {
+    pthread_t t_id;
+    dfs_split_t *split;
+    cga_graph_t *graph;
+    igraph_integer_t to;
+    const cga_dfs_limits_t *limits;
+    cga_path_visitor_t visitor;
+    void *arg;
+};
+
 struct tinfo {
     pthread_t t_id;
     char *filename;
-    igraph_t *graph;
+    cga_graph_t *graph;
     igraph_integer_t vertex;
-    igraph_integer_t lowerbound;
-    igraph_integer_t upperbound;
+    cga_sched_t *sched;
+    unsigned int worker;
+    const cga_analysis_opts_t *opts;
+    cga_output_t *output;  // consolidated output, NULL if each thread writes its own file
+    struct _analysis_ckpt *ckpt;  // checkpoint state of the thread, NULL without checkpoints
+    cga_status_t status;  // set by the job if its output file can't be opened or written
 };
 
-static void cga_dfs_vfree_rec_helper(igraph_t *graph, igraph_integer_t target, igraph_lazy_adjlist_t *adjlist, igraph_vector_int_t *curr_path, cga_hashset_t *used_nodes, igraph_vector_int_t *res);
-static int read_line(char **buf, int *size, FILE *file);
-static void get_as_rel_parts(char *str, as_rel_t *as_rel);
-static igraph_integer_t add_annotated_vertex(igraph_t *graph, cga_hashtable_t *ht, unsigned long as_num, igraph_vector_t *vertex_attr);
-static void add_annotated_edges_vect(igraph_vector_t *edges, igraph_vector_t *edges_attr, unsigned int as1_id, unsigned int as2_id, int relation);
+/**
+ * Checkpoint state of a thread of cga_graph_analysis: the header of its manifest, the targets it
+ * has completed (the ones of the resumed run included) and the time of its last checkpoint.
+ * If resumed is not 0 the output file already exists up to header.offset.
+ */
+typedef struct _analysis_ckpt {
+    char *manifest;
+    cga_checkpoint_header_t header;
+    uint32_t *done;
+    uint64_t size;  // allocated elements of done
+    int resumed;
+    struct timespec last;
+} analysis_ckpt_t;
+
+/**
+ * Result of a pair of nodes of cga_graph_analysis, pushed by the compute threads in the
+ * consolidated output and formatted by its writer thread as print_pair_row does.
+ */
+typedef struct _pair_record {
+    uint32_t from;
+    uint32_t to;
+    int truncated;  // -1 if there's no truncated column
+    int symmetric;  // if not 0 the row <to, from> is written too
+    cga_pair_stats_t stats;
+} pair_record_t;
+
+static int cga_dfs_vfree_rec_helper(rec_search_t *search, int state, int cost);
+static int dfs_ctx_search(cga_dfs_ctx_t *ctx, igraph_integer_t from, igraph_integer_t to, uint32_t first_lo, uint32_t first_hi, cga_path_visitor_t visitor, void *arg);
+static int dfs_ctx_search_subtree(cga_dfs_ctx_t *ctx, const dfs_subtree_t *subtree, igraph_integer_t to, cga_path_visitor_t visitor, void *arg, dfs_split_t *split);
+static void dfs_count(uint64_t expanded, uint64_t pruned, uint64_t paths);
+static int dfs_split_poll(dfs_split_t *split, cga_dfs_ctx_t *ctx, long base, long top, uint32_t hi);
+static int dfs_split_push(dfs_split_t *split, const igraph_integer_t *prefix, long length, int state, int cost, uint32_t lo, uint32_t hi);
+static int dfs_split_take(dfs_split_t *split, dfs_subtree_t *task);
+static void dfs_split_done(dfs_split_t *split, int res);
+static void *dfs_split_job(void *attr);
+static int append_path(cga_graph_t *graph, const cga_path_view_t *path, void *arg);
+static int print_path_row(cga_graph_t *graph, const cga_path_view_t *path, void *arg);
+static int count_simple_paths(cga_graph_t *graph, uint32_t from, uint32_t to, const cga_dfs_limits_t *limits, uint64_t *vfree, uint64_t *nvfree);
+static char *map_stream(FILE *instream, size_t *len, int *mapped);
+static void *parse_chunk_job(void *attr);
+static const char *parse_as_rel_line(const char *p, const char *end, as_rel_t *as_rel, int *res);
+static int scan_ulong(const char **p, const char *end, unsigned long *value);
+static igraph_integer_t add_annotated_vertex(cga_hashtable_t *ht, unsigned long as_num, unsigned long **labels, size_t *nlabels, size_t *labels_size);
+static void add_annotated_edge(cga_edge_t **edges, size_t *nedges, size_t *edges_size, igraph_integer_t as1_id, igraph_integer_t as2_id, int relation);
+static cga_status_t run_analysis(cga_graph_t *graph, igraph_integer_t vertex, unsigned int nthreads, char *filename, cga_sched_t *sched, const cga_analysis_opts_t *opts, cga_output_t *output, analysis_ckpt_t *ckpts, void *(*job)(void *));
+static const char *pair_header(int limited);
+static void format_pair_record(cga_writer_t *out, const void *record, void *arg);
+static void format_pair_record_binary(cga_writer_t *out, const void *record, void *arg);
+static void write_pairs_header(cga_writer_t *out, const cga_graph_t *graph, const cga_analysis_opts_t *opts);
+static void write_pair_binary(cga_writer_t *out, const cga_graph_t *graph, uint32_t from, uint32_t to, const cga_pair_stats_t *stats, int truncated);
+static cga_status_t build_result(const char *filename, unsigned int nfiles, int consolidated);
+static cga_sched_t *vertices_sched(cga_graph_t *graph, unsigned int nthreads, int weighted, int lower, const uint8_t *skip);
+static analysis_ckpt_t *ckpts_init(cga_graph_t *graph, const char *filename, unsigned int nthreads, const cga_analysis_opts_t *opts, uint8_t **skip, cga_status_t *status);
+static void ckpts_destroy(analysis_ckpt_t *ckpts, unsigned int nthreads);
+static void ckpt_task_done(analysis_ckpt_t *ckpt, uint32_t task, cga_writer_t *out, double interval);
+static void ckpt_save(analysis_ckpt_t *ckpt, cga_writer_t *out);
+static uint64_t analysis_options_id(const cga_analysis_opts_t *opts);
+static uint64_t graph_order_id(const cga_graph_t *graph);
+static void print_pair_row(cga_writer_t *out, cga_graph_t *graph, uint32_t from, uint32_t to, const cga_pair_stats_t *stats, int reversed, int truncated);
+static uint64_t vertex_weight(cga_graph_t *graph, uint32_t v);
 static void *cga_as_analysis_job(void *attr);
 static void *cga_graph_analysis_job(void *attr);
+static void *cga_graph_analysis_shortest_job(void *attr);
+static int vf_bfs_init(vf_bfs_t *bfs, uint32_t vcount);
+static void vf_bfs_destroy(vf_bfs_t *bfs);
+static void vf_bfs_run(cga_graph_t *graph, vf_bfs_t *bfs, uint32_t source);
 
-void cga_load_snapshot(igraph_t *graph, cga_hashtable_t *ht, FILE *instream) {
+void cga_load_snapshot(cga_graph_t *graph, cga_hashtable_t *ht, FILE *instream) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    cga_load_snapshot_parallel(graph, ht, instream, ncpu > 0 ? (unsigned int)ncpu : 1);
+}
+
+void cga_load_snapshot_parallel(cga_graph_t *graph, cga_hashtable_t *ht, FILE *instream, unsigned int nthreads) {
     if ((fcntl(fileno(instream), F_GETFL) & O_ACCMODE) == O_WRONLY) {
         fprintf(stderr, "cga_load_snapshot permission denied. Have you opened the file in write mode?\n");
         abort();
     }
-    int size = 250;
-    char *buf = malloc(size);
-    as_rel_t as_rel;
-    igraph_vector_t edges, edges_attr, vertex_attr;
-    igraph_vector_init(&edges, 0);
-    igraph_vector_init(&edges_attr, 0);
-    igraph_vector_init(&vertex_attr, 0);
-    igraph_empty(graph, 0, IGRAPH_DIRECTED);
-
-    while (read_line(&buf, &size, instream) != EOF) {
-        if (buf[0] == '#') continue;     // get rid of comments
-        buf[strcspn(buf, "\n")] = '\0';  // delete the newline
-        get_as_rel_parts(buf, &as_rel);
-        as_rel.as1_id = add_annotated_vertex(graph, ht, as_rel.as1, &vertex_attr);
-        as_rel.as2_id = add_annotated_vertex(graph, ht, as_rel.as2, &vertex_attr);
-        add_annotated_edges_vect(&edges, &edges_attr, as_rel.as1_id, as_rel.as2_id, as_rel.relation);
-        if (as_rel.relation == 0)  // if is a p2p relation, also add an inverse direct edge
-            add_annotated_edges_vect(&edges, &edges_attr, as_rel.as2_id, as_rel.as1_id, as_rel.relation);
-    }
-    igraph_add_vertices(graph, cga_ht_nelems(ht), 0);
-    igraph_add_edges(graph, &edges, 0);
-    for (long i = 0; i < igraph_vector_size(&edges_attr); i++) {
-        SETEAN(graph, "type", i, VECTOR(edges_attr)[i]);
-    }
-    for (long i = 0; i < igraph_vector_size(&vertex_attr); i = i + 2) {
-        SETVAN(graph, "label", VECTOR(vertex_attr)[i + 1], VECTOR(vertex_attr)[i]);
-    }
-    igraph_vector_destroy(&vertex_attr);
-    igraph_vector_destroy(&edges);
-    igraph_vector_destroy(&edges_attr);
-    free(buf);
-}
-
-int cga_is_valley_free(igraph_t *graph, igraph_vector_int_t *path) {
+    cga_stats_phase_begin(CGA_PHASE_LOAD);
+    size_t len;
+    int mapped;
+    char *data = map_stream(instream, &len, &mapped);
+    if (data == NULL) {
+        fprintf(stderr, "%s", "Out of memory while reading the as-rel file. Aborting process...");
+        abort();
+    }
+
+    // split the file in newline aligned chunks and parse them in parallel
+    unsigned int nchunks = len / PARSE_MIN_CHUNK + 1;
+    if (nthreads == 0) nthreads = 1;
+    if (nchunks > nthreads) nchunks = nthreads;
+    if (nchunks > PARSE_MAX_THREADS) nchunks = PARSE_MAX_THREADS;
+    parse_chunk_t chunks[PARSE_MAX_THREADS];
+    const char *p = data, *data_end = data + len;
+    for (unsigned int i = 0; i < nchunks; i++) {
+        const char *chunk_end = (i == nchunks - 1) ? data_end : data + len / nchunks * (i + 1);
+        if (chunk_end < p) chunk_end = p;
+        while (chunk_end < data_end && chunk_end[-1] != '\n') chunk_end++;
+        chunks[i].begin = p;
+        chunks[i].end = chunk_end;
+        p = chunk_end;
+    }
+    unsigned int started = 1;  // the first chunk is parsed by this thread
+    for (unsigned int i = 1; i < nchunks; i++, started++) {
+        if (pthread_create(&chunks[i].t_id, NULL, parse_chunk_job, &chunks[i]) != 0)
+            break;
+    }
+    parse_chunk_job(&chunks[0]);
+    for (unsigned int i = started; i < nchunks; i++)  // threads not available, parse here
+        parse_chunk_job(&chunks[i]);
+    for (unsigned int i = 1; i < started; i++)
+        pthread_join(chunks[i].t_id, NULL);
+    if (mapped)
+        munmap(data, len);
+    else
+        free(data);
+
+    // merge the chunks in file order, so the vertex ids follow the first appearance of the as_numbers
+    size_t total = 0, malformed = 0;
+    for (unsigned int i = 0; i < nchunks; i++) {
+        if (chunks[i].rels == NULL) {
+            fprintf(stderr, "%s", "Out of memory while parsing the as-rel file. Aborting process...");
+            abort();
+        }
+        total += chunks[i].nrels;
+        malformed += chunks[i].malformed;
+    }
+    if (malformed > 0)
+        fprintf(stderr, "cga_load_snapshot: %lu malformed lines skipped\n", (unsigned long)malformed);
+    size_t edges_size = total ? total : 1;
+    cga_edge_t *edges = malloc(edges_size * sizeof(cga_edge_t));
+    unsigned long *labels = NULL;
+    size_t nedges = 0, nlabels = 0, labels_size = 0;
+    if (edges == NULL || cga_ht_reserve(ht, cga_ht_nelems(ht) + total / 4) != SUCCESS) {
+        fprintf(stderr, "%s", "Out of memory while allocating the edges. Aborting process...");
+        abort();
+    }
+    for (unsigned int i = 0; i < nchunks; i++) {
+        for (size_t j = 0; j < chunks[i].nrels; j++) {
+            as_rel_t *as_rel = &chunks[i].rels[j];
+            as_rel->as1_id = add_annotated_vertex(ht, as_rel->as1, &labels, &nlabels, &labels_size);
+            as_rel->as2_id = add_annotated_vertex(ht, as_rel->as2, &labels, &nlabels, &labels_size);
+            add_annotated_edge(&edges, &nedges, &edges_size, as_rel->as1_id, as_rel->as2_id, as_rel->relation);
+        }
+        free(chunks[i].rels);
+    }
+    size_t vcount = cga_ht_nelems(ht) > nlabels ? cga_ht_nelems(ht) : nlabels;
+    cga_stats_phase_end(CGA_PHASE_LOAD);
+    cga_stats_phase_begin(CGA_PHASE_BUILD);
+    if (cga_graph_init(graph, vcount, edges, nedges) != SUCCESS) {
+        fprintf(stderr, "%s", "Out of memory while building the graph. Aborting process...");
+        abort();
+    }
+    memcpy(graph->labels, labels, nlabels * sizeof(unsigned long));
+    free(labels);
+    free(edges);
+    cga_stats_phase_end(CGA_PHASE_BUILD);
+}
+
+int cga_is_valley_free(cga_graph_t *graph, igraph_vector_int_t *path) {
     int state = 0, type_val;
-    igraph_integer_t eid;
     long i = 0;
     while (state >= 0 && i < igraph_vector_int_size(path) - 1) {
-        igraph_get_eid(graph, &eid, VECTOR(*path)[i], VECTOR(*path)[i + 1], igraph_is_directed(graph), 0);
-        if (eid == -1)
-            type_val = 1;  // customer to provider edge
-        else
-            type_val = (int)EAN(graph, "type", eid);
+        type_val = cga_graph_relation(graph, VECTOR(*path)[i], VECTOR(*path)[i + 1]);
         i++;
         switch (state) {
             case 0:
@@ -104,402 +345,1659 @@ int cga_is_valley_free(igraph_t *graph, igraph_vector_int_t *path) {
     return state >= 0 ? 1 : 0;
 }
 
-int cga_valley_free_state(igraph_t *graph, int current_state, igraph_integer_t old_node, igraph_integer_t new_node) {
-    igraph_integer_t eid;
-    igraph_get_eid(graph, &eid, old_node, new_node, igraph_is_directed(graph), 0);
-    int arc_type;
-    if (eid == -1)
-        arc_type = 1;  // customer to provider edge
-    else
-        arc_type = (int)EAN(graph, "type", eid);
-    switch (current_state) {
-        case 0:
-            if (arc_type == -1 || arc_type == 0)
-                current_state = 1;
-            break;
-        case 1:
-            if (arc_type == 1 || arc_type == 0)
-                current_state = -1;
-            break;
-    }
-    return current_state;
+void cga_dfs_vfree_rec(cga_graph_t *graph, igraph_vector_int_t *res, igraph_integer_t from, igraph_integer_t to) {
+    cga_dfs_visit_rec(graph, from, to, append_path, res);
 }
 
-void cga_dfs_vfree_rec(igraph_t *graph, igraph_vector_int_t *res, igraph_integer_t from, igraph_integer_t to) {
-    cga_hashset_t *hs = cga_hs_init(40);
-    igraph_vector_int_t curr_path;
-    igraph_lazy_adjlist_t adjlist;
-    igraph_lazy_adjlist_init(graph, &adjlist, IGRAPH_ALL, 1);
-    igraph_vector_int_init(&curr_path, 0);
-    igraph_vector_int_push_back(&curr_path, from);
-    cga_hs_insert(hs, from);
-    cga_dfs_vfree_rec_helper(graph, to, &adjlist, &curr_path, hs, res);
-    cga_hs_destroy(hs);
-    igraph_lazy_adjlist_destroy(&adjlist);
-    igraph_vector_int_destroy(&curr_path);
+void cga_search_opts_init(cga_search_opts_t *opts) {
+    opts->cones = NULL;
+    opts->limits.max_hops = 0;
+    opts->limits.budget = 0;
+}
+
+int cga_dfs_visit_rec(cga_graph_t *graph, igraph_integer_t from, igraph_integer_t to, cga_path_visitor_t visitor, void *arg) {
+    return cga_dfs_visit_rec_opts(graph, from, to, visitor, arg, NULL);
+}
+
+int cga_dfs_visit_rec_opts(cga_graph_t *graph, igraph_integer_t from, igraph_integer_t to, cga_path_visitor_t visitor, void *arg, const cga_search_opts_t *opts) {
+    cga_search_opts_t defaults;
+    if (opts == NULL) {
+        cga_search_opts_init(&defaults);
+        opts = &defaults;
+    }
+    rec_search_t search;
+    search.graph = graph;
+    search.cones = opts->cones;
+    search.target = to;
+    search.max_hops = opts->limits.max_hops;
+    search.budget = opts->limits.budget;
+    search.expanded = 0;
+    search.truncated = 0;
+    search.visitor = visitor;
+    search.arg = arg;
+    if (cga_vs_init(&search.used_nodes, cga_graph_vcount(graph)) != SUCCESS) {
+        fprintf(stderr, "%s", "Out of memory while allocating the visited set. Aborting process...");
+        abort();
+    }
+    igraph_vector_int_init(&search.curr_path, 0);
+    igraph_vector_int_push_back(&search.curr_path, from);
+    cga_vs_insert(&search.used_nodes, from);
+    int res = cga_dfs_vfree_rec_helper(&search, 0, 0);
+    cga_vs_destroy(&search.used_nodes);
+    igraph_vector_int_destroy(&search.curr_path);
+    return res;
 }
 
 /**
- * Helper function for get_all_vfree_paths.
- * It uses a DFS search to search all possible paths between 2 nodes, and retrieve only valley free paths
+ * Helper function for cga_dfs_visit_rec_opts.
+ * It uses a DFS search to search all possible paths between 2 nodes, and retrieve only valley free paths.
+ * state and cost are the state of the valley free automaton and the cost of the path at the
+ * last node of curr_path. If cones is not NULL, the downhill branches are followed only if
+ * target is in the customer cone of their first vertex.
+ * 
+ * Returns CGA_DFS_STOPPED if the search has been stopped by the visitor, CGA_DFS_TRUNCATED if
+ * the budget is exhausted, CGA_DFS_DONE otherwise (the paths cut by max_hops only set truncated)
  */
-static void cga_dfs_vfree_rec_helper(igraph_t *graph, igraph_integer_t target, igraph_lazy_adjlist_t *adjlist, igraph_vector_int_t *curr_path, cga_hashset_t *used_nodes, igraph_vector_int_t *res) {
+static int cga_dfs_vfree_rec_helper(rec_search_t *search, int state, int cost) {
+    cga_graph_t *graph = search->graph;
+    igraph_vector_int_t *curr_path = &search->curr_path;
     igraph_integer_t last_node = igraph_vector_int_tail(curr_path);
-    if (!cga_is_valley_free(graph, curr_path)) return;
-    if (last_node == target) {
-        igraph_vector_int_append(res, curr_path);
-        igraph_vector_int_push_back(res, -1);
-    } else {
-        igraph_vector_t *neighbors = igraph_lazy_adjlist_get(adjlist, last_node);
-        for (long i = 0; i < igraph_vector_size(neighbors); i++) {
-            if (!cga_hs_contains(used_nodes, (igraph_integer_t)VECTOR(*neighbors)[i])) {
-                igraph_vector_int_push_back(curr_path, (igraph_integer_t)VECTOR(*neighbors)[i]);
-                cga_hs_insert(used_nodes, (igraph_integer_t)VECTOR(*neighbors)[i]);
-                cga_dfs_vfree_rec_helper(graph, target, adjlist, curr_path, used_nodes, res);
-                cga_hs_delete(used_nodes, (igraph_integer_t)VECTOR(*neighbors)[i]);
-                igraph_vector_int_pop_back(curr_path);
+    long length = igraph_vector_int_size(curr_path) - 1;
+    if (last_node == search->target) {
+        cga_path_view_t view = {VECTOR(*curr_path), length, cost, state};
+        return search->visitor(graph, &view, search->arg) != 0 ? CGA_DFS_STOPPED : CGA_DFS_DONE;
+    }
+    for (uint32_t i = graph->offsets[last_node]; i < graph->offsets[last_node + 1]; i++) {
+        igraph_integer_t next = CGA_ADJ_VERTEX(graph->adj[i]);
+        int rel = CGA_ADJ_REL(graph->adj[i]);
+        int next_state = cga_vf_state(state, rel);
+        if (next_state == -1 || cga_vs_contains(&search->used_nodes, next)) continue;
+        if (search->cones != NULL && next_state == 1 && !cga_cones_contains(search->cones, next, search->target)) continue;  // can't go down to target
+        if (search->max_hops > 0 && length + 1 >= search->max_hops && next != search->target) {  // too long
+            search->truncated = 1;
+            continue;
+        }
+        if (search->budget > 0 && ++search->expanded > search->budget)
+            return CGA_DFS_TRUNCATED;
+        igraph_vector_int_push_back(curr_path, next);
+        cga_vs_insert(&search->used_nodes, next);
+        int res = cga_dfs_vfree_rec_helper(search, next_state, cost + rel);
+        cga_vs_delete(&search->used_nodes, next);
+        igraph_vector_int_pop_back(curr_path);
+        if (res != CGA_DFS_DONE) return res;
+    }
+    return (length == 0 && search->truncated) ? CGA_DFS_TRUNCATED : CGA_DFS_DONE;
+}
+
+void cga_dfs_vfree_it(cga_graph_t *graph, igraph_vector_int_t *res, igraph_integer_t from, igraph_integer_t to) {
+    cga_dfs_ctx_t *ctx = cga_dfs_ctx_init(graph);
+    if (ctx == NULL) {
+        fprintf(stderr, "%s", "Out of memory while allocating the DFS context. Aborting process...");
+        abort();
+    }
+    cga_dfs_ctx_vfree_it(ctx, res, from, to);
+    cga_dfs_ctx_destroy(ctx);
+}
+
+void cga_dfs_vfree_from(cga_graph_t *graph, igraph_vector_int_t *res, igraph_integer_t from) {
+    cga_dfs_ctx_t *ctx = cga_dfs_ctx_init(graph);
+    if (ctx == NULL) {
+        fprintf(stderr, "%s", "Out of memory while allocating the DFS context. Aborting process...");
+        abort();
+    }
+    cga_dfs_ctx_vfree_from(ctx, res, from);
+    cga_dfs_ctx_destroy(ctx);
+}
+
+cga_dfs_ctx_t *cga_dfs_ctx_init(cga_graph_t *graph) {
+    cga_dfs_ctx_t *ctx = malloc(sizeof(cga_dfs_ctx_t));
+    if (ctx == NULL)
+        return NULL;
+    size_t depth = (size_t)cga_graph_vcount(graph) + 1;  // a simple path can't be longer than that
+    ctx->graph = graph;
+    ctx->cursor = malloc(depth * sizeof(uint32_t));
+    ctx->dfa_state = malloc(depth * sizeof(int));
+    ctx->cost = malloc(depth * sizeof(int));
+    ctx->reach = malloc(depth * sizeof(uint8_t));
+    ctx->queue = malloc(2 * depth * sizeof(uint32_t));
+    ctx->target = -1;
+    cga_dfs_ctx_set_limits(ctx, NULL);
+    if (ctx->cursor == NULL || ctx->dfa_state == NULL || ctx->cost == NULL || ctx->reach == NULL || ctx->queue == NULL
+        || cga_vs_init(&ctx->used_nodes, cga_graph_vcount(graph)) != SUCCESS) {
+        free(ctx->cursor);
+        free(ctx->dfa_state);
+        free(ctx->cost);
+        free(ctx->reach);
+        free(ctx->queue);
+        free(ctx);
+        return NULL;
+    }
+    if (igraph_vector_int_init(&ctx->curr_path, 0) != 0) {
+        cga_vs_destroy(&ctx->used_nodes);
+        free(ctx->cursor);
+        free(ctx->dfa_state);
+        free(ctx->cost);
+        free(ctx->reach);
+        free(ctx->queue);
+        free(ctx);
+        return NULL;
+    }
+    igraph_vector_int_reserve(&ctx->curr_path, depth);
+    return ctx;
+}
+
+void cga_dfs_ctx_reset(cga_dfs_ctx_t *ctx) {
+    cga_vs_clear(&ctx->used_nodes);
+    igraph_vector_int_clear(&ctx->curr_path);
+}
+
+void cga_dfs_ctx_destroy(cga_dfs_ctx_t *ctx) {
+    cga_vs_destroy(&ctx->used_nodes);
+    igraph_vector_int_destroy(&ctx->curr_path);
+    free(ctx->cursor);
+    free(ctx->dfa_state);
+    free(ctx->cost);
+    free(ctx->reach);
+    free(ctx->queue);
+    free(ctx);
+}
+
+void cga_dfs_ctx_set_target(cga_dfs_ctx_t *ctx, igraph_integer_t to) {
+    if (ctx->target == to)
+        return;
+    cga_graph_t *graph = ctx->graph;
+    uint32_t head = 0, tail = 0;
+    memset(ctx->reach, 0, cga_graph_vcount(graph) * sizeof(uint8_t));
+    ctx->reach[to] = 3;  // the target is reached whatever the state
+    ctx->queue[tail++] = 2 * to;
+    ctx->queue[tail++] = 2 * to + 1;
+    while (head < tail) {
+        uint32_t w = ctx->queue[head] / 2;
+        int w_state = ctx->queue[head] % 2;
+        head++;
+        // a neighbor v in the state s reaches w in w_state if the hop v -> w moves s to w_state
+        for (uint32_t i = graph->offsets[w]; i < graph->offsets[w + 1]; i++) {
+            uint32_t v = CGA_ADJ_VERTEX(graph->adj[i]);
+            int rel = -CGA_ADJ_REL(graph->adj[i]);  // relationship of v towards w
+            for (int state = 0; state < 2; state++) {
+                if ((ctx->reach[v] & (1 << state)) || cga_vf_state(state, rel) != w_state) continue;
+                ctx->reach[v] |= 1 << state;
+                ctx->queue[tail++] = 2 * v + state;
             }
         }
     }
+    ctx->target = to;
 }
 
-void cga_dfs_vfree_it(igraph_t *graph, igraph_vector_int_t *res, igraph_integer_t from, igraph_integer_t to) {
-    cga_hashset_t *used_nodes = cga_hs_init(40);
-    igraph_lazy_adjlist_t adjlist;
-    igraph_vector_int_t curr_path;
-    igraph_stack_int_t stack;
-    igraph_vector_int_t dfa_state;
-    igraph_lazy_adjlist_init(graph, &adjlist, IGRAPH_ALL, 1);
-    igraph_stack_int_init(&stack, 0);
-    igraph_vector_int_init(&curr_path, 0);
-    igraph_vector_int_init(&dfa_state, 0);
-
-    // init stack with from and his neighbors
-    igraph_stack_int_push(&stack, from);
-    igraph_vector_int_push_back(&curr_path, from);
-    igraph_vector_int_push_back(&dfa_state, 0);  // dfa state starts from 0
-    cga_hs_insert(used_nodes, from);
-    igraph_vector_t *initial_neighbors = igraph_lazy_adjlist_get(&adjlist, from);
-    for (long i = 0; i < igraph_vector_size(initial_neighbors); i++) {
-        igraph_stack_int_push(&stack, VECTOR(*initial_neighbors)[i]);
-    }
-    while (!igraph_stack_int_empty(&stack)) {
-        igraph_integer_t curr_node = igraph_stack_int_top(&stack);
-        if (curr_node == igraph_vector_int_tail(&curr_path)) {  // his neighbors are already explored, delete the node from the stack
-            igraph_stack_int_pop(&stack);
-            igraph_vector_int_pop_back(&curr_path);
-            igraph_vector_int_pop_back(&dfa_state);
-            cga_hs_delete(used_nodes, curr_node);
+void cga_dfs_ctx_set_limits(cga_dfs_ctx_t *ctx, const cga_dfs_limits_t *limits) {
+    ctx->limits.max_hops = (limits != NULL) ? limits->max_hops : 0;
+    ctx->limits.budget = (limits != NULL) ? limits->budget : 0;
+}
+
+int cga_dfs_ctx_reachable(cga_dfs_ctx_t *ctx, igraph_integer_t from, igraph_integer_t to) {
+    cga_dfs_ctx_set_target(ctx, to);
+    return (ctx->reach[from] & 1) != 0;
+}
+
+int cga_dfs_ctx_can_reach(const cga_dfs_ctx_t *ctx, igraph_integer_t v, int state) {
+    return (ctx->reach[v] >> state) & 1;
+}
+
+void cga_dfs_ctx_vfree_it(cga_dfs_ctx_t *ctx, igraph_vector_int_t *res, igraph_integer_t from, igraph_integer_t to) {
+    dfs_ctx_search(ctx, from, to, 0, cga_graph_degree(ctx->graph, from), append_path, res);
+}
+
+void cga_dfs_ctx_vfree_from(cga_dfs_ctx_t *ctx, igraph_vector_int_t *res, igraph_integer_t from) {
+    dfs_ctx_search(ctx, from, -1, 0, cga_graph_degree(ctx->graph, from), append_path, res);
+}
+
+int cga_dfs_ctx_visit_it(cga_dfs_ctx_t *ctx, igraph_integer_t from, igraph_integer_t to, cga_path_visitor_t visitor, void *arg) {
+    return dfs_ctx_search(ctx, from, to, 0, cga_graph_degree(ctx->graph, from), visitor, arg);
+}
+
+int cga_dfs_ctx_visit_from(cga_dfs_ctx_t *ctx, igraph_integer_t from, cga_path_visitor_t visitor, void *arg) {
+    return dfs_ctx_search(ctx, from, -1, 0, cga_graph_degree(ctx->graph, from), visitor, arg);
+}
+
+/**
+ * Iterative valley free DFS from the vertex from, restricted to the subtrees of the neighbors
+ * of from with index in [first_lo, first_hi) inside its adjacency list.
+ * If to is a vertex_id, visitor is called for each valley free path from from to to, and the
+ * search doesn't go past to. If to is -1, visitor is called for each path of the valley free
+ * DFS tree, i.e. once for each valley free path from from to any other vertex.
+ * 
+ * Arguments:
+ * ctx: Pointer to the DFS context
+ * from: The starting vertex_id
+ * to: The ending vertex_id, or -1 to report the paths towards all vertices
+ * first_lo: Index of the first neighbor of from to explore
+ * first_hi: Index of the last neighbor of from to explore, plus one
+ * visitor: Function called for each path found
+ * arg: Argument passed to visitor
+ * 
+ * Returns CGA_DFS_STOPPED if the search has been stopped by the visitor, CGA_DFS_TRUNCATED if
+ * some paths have been cut by the limits of the context, CGA_DFS_DONE otherwise
+ */
+static int dfs_ctx_search(cga_dfs_ctx_t *ctx, igraph_integer_t from, igraph_integer_t to, uint32_t first_lo, uint32_t first_hi, cga_path_visitor_t visitor, void *arg) {
+    igraph_integer_t prefix = from;
+    dfs_subtree_t subtree = {&prefix, 0, 0, 0, ctx->graph->offsets[from] + first_lo, ctx->graph->offsets[from] + first_hi};
+    return dfs_ctx_search_subtree(ctx, &subtree, to, visitor, arg, NULL);
+}
+
+/**
+ * Same as dfs_ctx_search, exploring the paths that extend the prefix of subtree. The frames of
+ * the prefix are never popped, so the neighbors of its vertices outside the subtree are left to
+ * whoever owns them.
+ * If split is not NULL the search shares its work with the other threads of split: every
+ * DFS_SPLIT_POLL expansions it gives away a part of its frontier if some thread is idle, and it
+ * returns as soon as the search is halted by another thread.
+ */
+static int dfs_ctx_search_subtree(cga_dfs_ctx_t *ctx, const dfs_subtree_t *subtree, igraph_integer_t to, cga_path_visitor_t visitor, void *arg, dfs_split_t *split) {
+    cga_graph_t *graph = ctx->graph;
+    igraph_vector_int_t *curr_path = &ctx->curr_path;
+    uint32_t *cursor = ctx->cursor;
+    int *dfa_state = ctx->dfa_state;
+    int *cost = ctx->cost;
+    cga_path_view_t view;
+    long base = subtree->length;  // frame of the last vertex of the prefix
+    cga_dfs_ctx_reset(ctx);
+    if (to >= 0) {
+        cga_dfs_ctx_set_target(ctx, to);
+        if (!(ctx->reach[subtree->prefix[base]] & (1 << subtree->state)))
+            return CGA_DFS_DONE;  // there's no valley free path towards to
+    }
+    const uint8_t *reach = (to >= 0) ? ctx->reach : NULL;
+    long max_hops = ctx->limits.max_hops;
+    uint64_t budget = ctx->limits.budget, expanded = 0;
+    uint64_t nodes = 0, pruned = 0, paths = 0;  // counted here, added to the statistics at the end
+    int truncated = 0;
+
+    for (long k = 0; k <= base; k++) {
+        igraph_vector_int_push_back(curr_path, subtree->prefix[k]);
+        cga_vs_insert(&ctx->used_nodes, subtree->prefix[k]);
+    }
+    long top = base;  // index of the last frame of the stack
+    cursor[base] = subtree->lo;
+    dfa_state[base] = subtree->state;
+    cost[base] = subtree->cost;
+    while (top >= base) {
+        igraph_integer_t last = VECTOR(*curr_path)[top];
+        uint32_t end = (top == base) ? subtree->hi : graph->offsets[last + 1];
+        if (cursor[top] == end) {  // all the neighbors are explored, backtrack
+            cga_vs_delete(&ctx->used_nodes, last);
+            igraph_vector_int_pop_back(curr_path);
+            top--;
             continue;
         }
-        int state = cga_valley_free_state(graph, igraph_vector_int_tail(&dfa_state), igraph_vector_int_tail(&curr_path), curr_node);
+        uint32_t w = graph->adj[cursor[top]++];
+        igraph_integer_t next = CGA_ADJ_VERTEX(w);
+        int state = cga_vf_state(dfa_state[top], CGA_ADJ_REL(w));
         if (state == -1) {  // not valley free
-            igraph_stack_int_pop(&stack);
+            pruned++;
             continue;
-        } else {
-            igraph_vector_int_push_back(&curr_path, curr_node);
-            igraph_vector_int_push_back(&dfa_state, state);
         }
-
-        if (curr_node == to) {  // found a solution
-            igraph_vector_int_append(res, &curr_path);
-            igraph_vector_int_push_back(res, -1);
-            igraph_stack_int_pop(&stack);
-            igraph_vector_int_pop_back(&curr_path);
-            igraph_vector_int_pop_back(&dfa_state);
+        if (cga_vs_contains(&ctx->used_nodes, next)) continue;  // not simple
+        if (reach != NULL && !(reach[next] & (1 << state))) {  // to can't be reached from here
+            pruned++;
             continue;
         }
-        cga_hs_insert(used_nodes, curr_node);
-        igraph_vector_t *neighbors = igraph_lazy_adjlist_get(&adjlist, curr_node);
-        for (long i = 0; i < igraph_vector_size(neighbors); i++) {
-            if (!cga_hs_contains(used_nodes, (igraph_integer_t)VECTOR(*neighbors)[i])) {
-                igraph_stack_int_push(&stack, (igraph_integer_t)VECTOR(*neighbors)[i]);
+        igraph_vector_int_push_back(curr_path, next);
+        if (to < 0 || next == to) {
+            view.vertices = VECTOR(*curr_path);
+            view.length = top + 1;
+            view.cost = cost[top] + CGA_ADJ_REL(w);
+            view.state = state;
+            paths++;
+            if (visitor(graph, &view, arg) != 0) {  // stopped by the visitor, leave the context clean
+                dfs_count(nodes, pruned, paths);
+                cga_dfs_ctx_reset(ctx);
+                return CGA_DFS_STOPPED;
+            }
+        }
+        if (next == to) {  // found a solution, the paths must end here
+            igraph_vector_int_pop_back(curr_path);
+            continue;
+        }
+        if (max_hops > 0 && top + 1 >= max_hops) {  // the paths through next would be too long
+            truncated = 1;
+            igraph_vector_int_pop_back(curr_path);
+            continue;
+        }
+        if (budget > 0 && ++expanded > budget) {  // budget exhausted, leave the context clean
+            dfs_count(nodes, pruned, paths);
+            cga_dfs_ctx_reset(ctx);
+            return CGA_DFS_TRUNCATED;
+        }
+        top++;
+        nodes++;
+        cursor[top] = graph->offsets[next];
+        dfa_state[top] = state;
+        cost[top] = cost[top - 1] + CGA_ADJ_REL(w);
+        cga_vs_insert(&ctx->used_nodes, next);
+        if (split != NULL && ++expanded % DFS_SPLIT_POLL == 0) {
+            int halt = dfs_split_poll(split, ctx, base, top, subtree->hi);
+            if (halt != CGA_DFS_DONE) {  // halted by another thread, leave the context clean
+                dfs_count(nodes, pruned, paths);
+                cga_dfs_ctx_reset(ctx);
+                return halt;
             }
         }
     }
-    igraph_stack_int_destroy(&stack);
-    cga_hs_destroy(used_nodes);
-    igraph_lazy_adjlist_destroy(&adjlist);
-    igraph_vector_int_destroy(&curr_path);
-    igraph_vector_int_destroy(&dfa_state);
+    dfs_count(nodes, pruned, paths);
+    if (base > 0)  // the frames of the prefix are still there
+        cga_dfs_ctx_reset(ctx);
+    return truncated ? CGA_DFS_TRUNCATED : CGA_DFS_DONE;
+}
+
+/**
+ * Adds the work of a depth first search to the statistics of the thread
+ */
+static void dfs_count(uint64_t expanded, uint64_t pruned, uint64_t paths) {
+    cga_stats_add(CGA_STAT_EXPANDED, expanded);
+    cga_stats_add(CGA_STAT_PRUNED, pruned);
+    cga_stats_add(CGA_STAT_PATHS, paths);
+}
+
+int cga_dfs_split_visit(cga_graph_t *graph, igraph_integer_t from, igraph_integer_t to, unsigned int nthreads, const cga_dfs_limits_t *limits, cga_path_visitor_t visitor, void **args) {
+    dfs_split_t split;
+    split.tasks = NULL;
+    split.ntasks = split.size = 0;
+    split.active = 0;
+    split.hungry = 0;
+    split.halt = CGA_DFS_DONE;
+    split.truncated = 0;
+    split.budget = (limits != NULL) ? limits->budget : 0;
+    split.expanded = 0;
+    pthread_mutex_init(&split.lock, NULL);
+    pthread_cond_init(&split.cond, NULL);
+    if (dfs_split_push(&split, &from, 0, 0, 0, graph->offsets[from], graph->offsets[from + 1]) != 0) {
+        fprintf(stderr, "%s", "Out of memory while allocating the search tasks. Aborting process...");
+        abort();
+    }
+
+    struct split_tinfo *ti = calloc(nthreads, sizeof(struct split_tinfo));
+    if (ti == NULL) {
+        fprintf(stderr, "%s", "Out of memory while allocating the search threads. Aborting process...");
+        abort();
+    }
+    // the pool finishes the search with any number of workers, so the ones that can't be
+    // started are left out; if none starts the search runs in this thread
+    unsigned int started = 0;
+    for (unsigned int i = 0; i < nthreads; i++, started++) {
+        ti[i].split = &split;
+        ti[i].graph = graph;
+        ti[i].to = to;
+        ti[i].limits = limits;
+        ti[i].visitor = visitor;
+        ti[i].arg = args[i];
+        if (pthread_create(&ti[i].t_id, NULL, dfs_split_job, &ti[i]) != 0)
+            break;
+    }
+    if (started == 0)
+        dfs_split_job(&ti[0]);
+    for (unsigned int i = 0; i < started; i++) {
+        pthread_join(ti[i].t_id, NULL);
+    }
+    free(ti);
+
+    for (size_t i = 0; i < split.ntasks; i++)  // left by a halted search
+        free(split.tasks[i].prefix);
+    free(split.tasks);
+    pthread_cond_destroy(&split.cond);
+    pthread_mutex_destroy(&split.lock);
+    if (split.halt != CGA_DFS_DONE)
+        return split.halt;
+    return split.truncated ? CGA_DFS_TRUNCATED : CGA_DFS_DONE;
+}
+
+int cga_pair_stats_split(cga_graph_t *graph, igraph_integer_t from, igraph_integer_t to, unsigned int nthreads, const cga_dfs_limits_t *limits, cga_pair_stats_t *stats) {
+    cga_pair_stats_t *partial = malloc(nthreads * sizeof(cga_pair_stats_t));
+    void **args = malloc(nthreads * sizeof(void *));
+    if (partial == NULL || args == NULL) {
+        fprintf(stderr, "%s", "Out of memory while allocating the search threads. Aborting process...");
+        abort();
+    }
+    for (unsigned int i = 0; i < nthreads; i++) {
+        cga_pair_stats_init(&partial[i]);
+        args[i] = &partial[i];
+    }
+    int res = cga_dfs_split_visit(graph, from, to, nthreads, limits, cga_pair_stats_visitor, args);
+    cga_pair_stats_init(stats);
+    for (unsigned int i = 0; i < nthreads; i++)
+        cga_pair_stats_merge(stats, &partial[i]);
+    free(args);
+    free(partial);
+    return res;
+}
+
+/**
+ * Thread of cga_dfs_split_visit: explores the subtrees of the pool until all of them are done.
+ * The budget is counted by the pool, so the context only keeps max_hops.
+ */
+static void *dfs_split_job(void *attr) {
+    struct split_tinfo *ti = (struct split_tinfo *)attr;
+    cga_dfs_ctx_t *ctx = cga_dfs_ctx_init(ti->graph);
+    if (ctx == NULL) {
+        fprintf(stderr, "%s", "Out of memory while allocating the DFS context. Aborting process...");
+        abort();
+    }
+    cga_dfs_limits_t limits = {(ti->limits != NULL) ? ti->limits->max_hops : 0, 0};
+    cga_dfs_ctx_set_limits(ctx, &limits);
+    dfs_subtree_t task;
+    while (dfs_split_take(ti->split, &task)) {
+        int res = dfs_ctx_search_subtree(ctx, &task, ti->to, ti->visitor, ti->arg, ti->split);
+        free(task.prefix);
+        dfs_split_done(ti->split, res);
+    }
+    cga_dfs_ctx_destroy(ctx);
+    return NULL;
+}
+
+/**
+ * Called by a search every DFS_SPLIT_POLL expansions. Adds them to the shared budget and, if
+ * some thread is waiting for work, moves the unexplored neighbors of the shallowest frame with
+ * some left (the largest subtrees) into a task of the pool.
+ * 
+ * Returns CGA_DFS_DONE if the search can go on, the reason of the halt otherwise
+ */
+static int dfs_split_poll(dfs_split_t *split, cga_dfs_ctx_t *ctx, long base, long top, uint32_t hi) {
+    if (split->budget > 0 && __atomic_add_fetch(&split->expanded, DFS_SPLIT_POLL, __ATOMIC_RELAXED) > split->budget) {
+        pthread_mutex_lock(&split->lock);
+        if (split->halt == CGA_DFS_DONE) __atomic_store_n(&split->halt, CGA_DFS_TRUNCATED, __ATOMIC_RELAXED);
+        pthread_cond_broadcast(&split->cond);
+        pthread_mutex_unlock(&split->lock);
+    }
+    int halt = __atomic_load_n(&split->halt, __ATOMIC_RELAXED);
+    if (halt != CGA_DFS_DONE)
+        return halt;
+    if (__atomic_load_n(&split->hungry, __ATOMIC_RELAXED) == 0)
+        return CGA_DFS_DONE;
+    cga_graph_t *graph = ctx->graph;
+    const igraph_integer_t *path = VECTOR(ctx->curr_path);
+    for (long k = base; k < top; k++) {  // the frame top has just been entered, it's not worth it
+        uint32_t end = (k == base) ? hi : graph->offsets[path[k] + 1];
+        if (ctx->cursor[k] == end) continue;
+        if (dfs_split_push(split, path, k, ctx->dfa_state[k], ctx->cost[k], ctx->cursor[k], end) == 0)
+            ctx->cursor[k] = end;  // the neighbors left now belong to the task
+        break;
+    }
+    return CGA_DFS_DONE;
 }
 
-int cga_path_cost(igraph_t *graph, igraph_vector_int_t *path) {
+/**
+ * Adds to the pool the subtree of the neighbors [lo, hi) of prefix[length], copying the prefix,
+ * and wakes up a waiting thread. Nothing is added if there are already enough tasks for the
+ * waiting threads (except the first task, pushed before the threads start).
+ * 
+ * Returns 0 if the task has been added, -1 otherwise
+ */
+static int dfs_split_push(dfs_split_t *split, const igraph_integer_t *prefix, long length, int state, int cost, uint32_t lo, uint32_t hi) {
+    int res = -1;
+    pthread_mutex_lock(&split->lock);
+    if (split->ntasks < (size_t)split->hungry || split->active == 0) {
+        if (split->ntasks == split->size) {
+            size_t size = split->size ? 2 * split->size : 16;
+            dfs_subtree_t *tasks = realloc(split->tasks, size * sizeof(dfs_subtree_t));
+            if (tasks != NULL) {
+                split->tasks = tasks;
+                split->size = size;
+            }
+        }
+        igraph_integer_t *copy = malloc((length + 1) * sizeof(igraph_integer_t));
+        if (copy != NULL && split->ntasks < split->size) {
+            memcpy(copy, prefix, (length + 1) * sizeof(igraph_integer_t));
+            dfs_subtree_t *task = &split->tasks[split->ntasks++];
+            task->prefix = copy;
+            task->length = length;
+            task->state = state;
+            task->cost = cost;
+            task->lo = lo;
+            task->hi = hi;
+            pthread_cond_signal(&split->cond);
+            res = 0;
+        } else {
+            free(copy);  // the search keeps the subtree for itself
+        }
+    }
+    pthread_mutex_unlock(&split->lock);
+    return res;
+}
+
+/**
+ * Takes a task from the pool, waiting until one is available.
+ * 
+ * Returns 1 if a task has been stored in task, 0 if the search is over (all the threads are
+ * waiting with an empty pool, or the search has been halted)
+ */
+static int dfs_split_take(dfs_split_t *split, dfs_subtree_t *task) {
+    pthread_mutex_lock(&split->lock);
+    while (split->ntasks == 0 && split->active > 0 && split->halt == CGA_DFS_DONE) {
+        __atomic_add_fetch(&split->hungry, 1, __ATOMIC_RELAXED);
+        pthread_cond_wait(&split->cond, &split->lock);
+        __atomic_sub_fetch(&split->hungry, 1, __ATOMIC_RELAXED);
+    }
+    if (split->ntasks == 0 || split->halt != CGA_DFS_DONE) {
+        pthread_cond_broadcast(&split->cond);  // wake up the others, the search is over
+        pthread_mutex_unlock(&split->lock);
+        return 0;
+    }
+    *task = split->tasks[--split->ntasks];
+    split->active++;
+    pthread_mutex_unlock(&split->lock);
+    return 1;
+}
+
+/**
+ * Records the result of a task. The last thread to finish, with an empty pool, ends the search.
+ */
+static void dfs_split_done(dfs_split_t *split, int res) {
+    pthread_mutex_lock(&split->lock);
+    split->active--;
+    if (res == CGA_DFS_STOPPED && split->halt == CGA_DFS_DONE)
+        __atomic_store_n(&split->halt, CGA_DFS_STOPPED, __ATOMIC_RELAXED);
+    if (res == CGA_DFS_TRUNCATED)
+        split->truncated = 1;
+    if ((split->active == 0 && split->ntasks == 0) || split->halt != CGA_DFS_DONE)
+        pthread_cond_broadcast(&split->cond);
+    pthread_mutex_unlock(&split->lock);
+}
+
+/**
+ * cga_path_visitor_t that appends the path to the vector arg, followed by a -1 marker
+ */
+static int append_path(cga_graph_t *graph, const cga_path_view_t *path, void *arg) {
+    igraph_vector_int_t *res = (igraph_vector_int_t *)arg;
+    for (long i = 0; i <= path->length; i++)
+        igraph_vector_int_push_back(res, path->vertices[i]);
+    igraph_vector_int_push_back(res, -1);
+    return 0;
+}
+
+/**
+ * cga_path_visitor_t that prints the <from,to,length,cost> row of the path in the cga_writer_t arg
+ */
+static int print_path_row(cga_graph_t *graph, const cga_path_view_t *path, void *arg) {
+    cga_writer_t *out = (cga_writer_t *)arg;
+    cga_writer_uint(out, cga_graph_label(graph, path->vertices[0]));
+    cga_writer_putc(out, ',');
+    cga_writer_uint(out, cga_graph_label(graph, path->vertices[path->length]));
+    cga_writer_putc(out, ',');
+    cga_writer_int(out, path->length);
+    cga_writer_putc(out, ',');
+    cga_writer_int(out, path->cost);
+    cga_writer_putc(out, '\n');
+    return 0;
+}
+
+void cga_pair_stats_merge(cga_pair_stats_t *dst, const cga_pair_stats_t *src) {
+    dst->count += src->count;
+    dst->length_sum += src->length_sum;
+    if (src->length_min < dst->length_min) dst->length_min = src->length_min;
+    if (src->length_max > dst->length_max) dst->length_max = src->length_max;
+    dst->cost_sum += src->cost_sum;
+    if (src->cost_min < dst->cost_min) dst->cost_min = src->cost_min;
+    if (src->cost_max > dst->cost_max) dst->cost_max = src->cost_max;
+}
+
+int cga_pair_stats_visitor(cga_graph_t *graph, const cga_path_view_t *path, void *arg) {
+    cga_pair_stats_add((cga_pair_stats_t *)arg, (int)path->length, path->cost);
+    return 0;
+}
+
+
+int cga_path_cost(cga_graph_t *graph, igraph_vector_int_t *path) {
     int total = 0;
-    igraph_integer_t eid;
     for (long i = 0; i < igraph_vector_int_size(path) - 1; i++) {
-        igraph_get_eid(graph, &eid, VECTOR(*path)[i], VECTOR(*path)[i + 1], igraph_is_directed(graph), 0);
-        if (eid == -1)
-            total += 1;  // customer to provider edge
-        else
-            total += (int)EAN(graph, "type", eid);
+        total += cga_graph_relation(graph, VECTOR(*path)[i], VECTOR(*path)[i + 1]);
     }
     return total;
 }
 
 /**
- * This function uses a dynamic buffer to read an entire line (\n included).
- * The content of the line is stored in the buf variable. 
- * The size of the buffer is changed iff the line length is greater than the size of the buffer. (the value is doubled every time this happens)
+ * This function gives the content of the stream from its current position to the end.
+ * Regular files are mapped in memory with mmap, any other stream (e.g. a pipe) is read
+ * in a dynamic buffer.
  * 
  * Arguments:
- * buf: pointer to string. After the reading operation the line is stored here.
- * size: pointer to integer that represent the size of the buffer. 
- *      This value change iff the line length is greater than the size of the buffer (the value is doubled every time this happens).
- * file: pointer to a stream. It should be readable.
- */
-static int read_line(char **buf, int *size, FILE *file) {
-    int old_size;
-    char *offset;
-    if (fgets(*buf, *size, file) == NULL)
-        return EOF;
-
-    if (strchr(*buf, '\n') != NULL)
-        return strlen(*buf);
-
-    do {
-        old_size = *size;
-        *size *= 2;
-        char *temp = realloc(*buf, *size);
-        if (temp == NULL) {
-            free(*buf);
-            fprintf(stderr, "%s", "Out of memory while allocating buffer for reading. Aborting process...");
-            fclose(file);
-            abort();
+ * instream: pointer to a stream. It should be readable.
+ * len: pointer where the length of the content is stored
+ * mapped: pointer where 1 is stored if the content has been mapped (and must be released with
+ *         munmap), 0 if it has been read in a buffer (to release with free)
+ * 
+ * Returns the content of the stream, NULL if there's not enough memory
+ */
+static char *map_stream(FILE *instream, size_t *len, int *mapped) {
+    struct stat st;
+    int fd = fileno(instream);
+    off_t pos = ftello(instream);
+    *mapped = 0;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && pos >= 0 && st.st_size > pos) {
+        char *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, st.st_size, MADV_SEQUENTIAL);
+            // the content starts at the stream position, map the whole file and skip the head
+            if (pos == 0) {
+                *mapped = 1;
+                *len = st.st_size;
+                return data;
+            }
+            char *buf = malloc(st.st_size - pos);
+            if (buf != NULL) memcpy(buf, data + pos, st.st_size - pos);
+            munmap(data, st.st_size);
+            *len = st.st_size - pos;
+            return buf;
+        }
+    }
+    size_t size = 1 << 16, n = 0, r;
+    char *buf = malloc(size);
+    if (buf == NULL) return NULL;
+    while ((r = fread(buf + n, 1, size - n, instream)) > 0) {
+        n += r;
+        if (n == size) {
+            char *temp = realloc(buf, size * 2);
+            if (temp == NULL) {
+                free(buf);
+                return NULL;
+            }
+            buf = temp;
+            size *= 2;
         }
-        *buf = temp;
-        offset = &((*buf)[old_size - 1]);
-    } while (fgets(offset, old_size + 1, file) && strchr(offset, '\n') == NULL);
+    }
+    *len = n;
+    return buf;
+}
 
-    return strlen(*buf);
+/**
+ * Thread job that parses all the lines of a chunk into its rels array.
+ * If there's not enough memory rels is left NULL.
+ */
+static void *parse_chunk_job(void *attr) {
+    parse_chunk_t *chunk = (parse_chunk_t *)attr;
+    const char *p = chunk->begin;
+    chunk->nrels = 0;
+    chunk->malformed = 0;
+    chunk->size = (chunk->end - chunk->begin) / 12 + 16;  // a serial-1 line is at least 12 bytes long
+    chunk->rels = malloc(chunk->size * sizeof(as_rel_t));
+    while (chunk->rels != NULL && p < chunk->end) {
+        int res;
+        if (chunk->nrels == chunk->size) {
+            as_rel_t *temp = realloc(chunk->rels, chunk->size * 2 * sizeof(as_rel_t));
+            if (temp == NULL) {
+                free(chunk->rels);
+                chunk->rels = NULL;
+                break;
+            }
+            chunk->rels = temp;
+            chunk->size *= 2;
+        }
+        p = parse_as_rel_line(p, chunk->end, &chunk->rels[chunk->nrels], &res);
+        if (res > 0)
+            chunk->nrels++;
+        else if (res < 0)
+            chunk->malformed++;
+    }
+    return NULL;
 }
 
 /**
- * This function fetch as_num1, as_num2 and the relationship from the string str, and store their values in as_rel
+ * This function fetch as_num1, as_num2 and the relationship from the line starting at p and
+ * store their values in as_rel. The line must have the format <as_num_1>|<as_num_2>|relationship,
+ * any other field following the relationship (e.g. the source of serial-2 files) is ignored.
  * 
  * Arguments:
- * str: string to fetch
+ * p: pointer to the first character of the line
+ * end: pointer to the end of the buffer
  * as_rel: pointer to a struct defined internally
+ * res: pointer where the result is stored: 1 if as_rel has been filled, 0 if the line is empty
+ *      or a comment, -1 if the line is malformed
+ * 
+ * Returns a pointer to the first character of the next line
+ */
+static const char *parse_as_rel_line(const char *p, const char *end, as_rel_t *as_rel, int *res) {
+    const char *next = memchr(p, '\n', end - p);
+    next = (next != NULL) ? next + 1 : end;
+    if (*p == '#' || *p == '\n' || *p == '\r') {  // comment or empty line
+        *res = 0;
+        return next;
+    }
+    unsigned long as1, as2, relation;
+    int negative;
+    *res = -1;
+    if (!scan_ulong(&p, next, &as1) || p == next || *p++ != '|') return next;
+    if (!scan_ulong(&p, next, &as2) || p == next || *p++ != '|') return next;
+    negative = (p < next && *p == '-');
+    if (negative) p++;
+    if (!scan_ulong(&p, next, &relation) || relation > 1) return next;
+    if (p < next && *p != '|' && *p != '\n' && *p != '\r') return next;
+    as_rel->as1 = as1;
+    as_rel->as2 = as2;
+    as_rel->relation = negative ? -(int)relation : (int)relation;
+    *res = 1;
+    return next;
+}
+
+/**
+ * Parses the decimal number starting at *p, moving *p past its last digit.
+ * 
+ * Returns 1 if at least a digit has been parsed, 0 otherwise
  */
-static void get_as_rel_parts(char *str, as_rel_t *as_rel) {
-    char *str_part;
-    str_part = strtok(str, "|");
-    as_rel->as1 = (unsigned int)strtoul(str_part, NULL, 10);
-    str_part = strtok(NULL, "|");
-    as_rel->as2 = (unsigned int)strtoul(str_part, NULL, 10);
-    str_part = strtok(NULL, "|");
-    as_rel->relation = (int)strtol(str_part, NULL, 10);
+static int scan_ulong(const char **p, const char *end, unsigned long *value) {
+    const char *begin = *p;
+    unsigned long v = 0;
+    while (*p < end && **p >= '0' && **p <= '9')
+        v = v * 10 + (*(*p)++ - '0');
+    *value = v;
+    return *p != begin;
 }
 
 /**
- * This function insert into the vertex_attr the as_num and the id of a vertex, following this pattern:
- * <AS_NUM, ID> 
- * It also stores the pairs <as_num, vertex_id> into the hashtable if not already inside.
+ * This function returns the vertex id associated with as_num, storing the pair <as_num, vertex_id>
+ * into the hashtable if not already inside. The as_num is also stored in labels at the index
+ * given by the vertex id, growing the array when needed.
  * 
  * Arguments:
- * graph: The graph.
  * ht: pointer to a hash table.
  * as_num: the autonomous system number to store into the graph
- * vertex_attr: vector in which the as_num and id of the vertex are stored
+ * labels: pointer to the dynamic array of as_numbers, indexed by vertex id
+ * nlabels: pointer to the number of elements of labels in use (the highest vertex id + 1)
+ * labels_size: pointer to the number of elements allocated for labels
  * 
  * Returns the vertex id associated with the given as_num
  */
-static igraph_integer_t add_annotated_vertex(igraph_t *graph, cga_hashtable_t *ht, unsigned long as_num, igraph_vector_t *vertex_attr) {
-    igraph_vector_push_back(vertex_attr, as_num);
+static igraph_integer_t add_annotated_vertex(cga_hashtable_t *ht, unsigned long as_num, unsigned long **labels, size_t *nlabels, size_t *labels_size) {
+    igraph_integer_t id;
     igraph_integer_t *res = cga_ht_search(ht, as_num);
 
     if (res == NULL) {
-        size_t id = cga_ht_nelems(ht);
+        id = (igraph_integer_t)cga_ht_nelems(ht);
         cga_ht_insert(ht, as_num, id);
-        igraph_vector_push_back(vertex_attr, id);
-        return (igraph_integer_t)id;
+    } else {
+        id = *res;
     }
-    igraph_vector_push_back(vertex_attr, *res);
-    return *res;
+    if ((size_t)id >= *labels_size) {
+        size_t new_size = *labels_size == 0 ? 1024 : *labels_size;
+        while (new_size <= (size_t)id) new_size *= 2;
+        unsigned long *temp = realloc(*labels, new_size * sizeof(unsigned long));
+        if (temp == NULL) {
+            fprintf(stderr, "%s", "Out of memory while allocating the labels. Aborting process...");
+            abort();
+        }
+        memset(&temp[*labels_size], 0, (new_size - *labels_size) * sizeof(unsigned long));
+        *labels = temp;
+        *labels_size = new_size;
+    }
+    (*labels)[id] = as_num;
+    if ((size_t)id >= *nlabels) *nlabels = id + 1;
+    return id;
 }
 
 /**
- * This function stores to the vector "edges" the starting and ending vertex of the edge 
- * and stores the attribute type provided by relation into the vector edges_attr.
+ * This function appends to the dynamic array edges the relationship between the two
+ * autonomous systems, growing the array when needed.
  * 
  * Arguments:
- * edges: pointer to a vector where the starting and ending vertices of the edge are stored
- * edges_attr: pointer to a vector where the type of the edge is stored
+ * edges: pointer to the dynamic array of relationships
+ * nedges: pointer to the number of relationships stored in edges
+ * edges_size: pointer to the number of elements allocated for edges
  * as1_id: the first autonomous system id 
  * as2_id: the second autonomous system id 
  * relation: the type of the edge (p2c or p2p)
  */
-static void add_annotated_edges_vect(igraph_vector_t *edges, igraph_vector_t *edges_attr, unsigned int as1_id, unsigned int as2_id, int relation) {
-    igraph_vector_push_back(edges, as1_id);
-    igraph_vector_push_back(edges, as2_id);
-    igraph_vector_push_back(edges_attr, relation);
+static void add_annotated_edge(cga_edge_t **edges, size_t *nedges, size_t *edges_size, igraph_integer_t as1_id, igraph_integer_t as2_id, int relation) {
+    if (*nedges == *edges_size) {
+        size_t new_size = *edges_size == 0 ? 4096 : *edges_size * 2;
+        cga_edge_t *temp = realloc(*edges, new_size * sizeof(cga_edge_t));
+        if (temp == NULL) {
+            fprintf(stderr, "%s", "Out of memory while allocating the edges. Aborting process...");
+            abort();
+        }
+        *edges = temp;
+        *edges_size = new_size;
+    }
+    (*edges)[*nedges].from = as1_id;
+    (*edges)[*nedges].to = as2_id;
+    (*edges)[*nedges].rel = relation;
+    (*nedges)++;
 }
 
-float cga_degree_freedom_path(igraph_t *graph, igraph_integer_t vertex1_id, igraph_integer_t vertex2_id, unsigned int *num_vfree, unsigned int *num_novfree) {
-    igraph_vector_int_t res, v;
-    unsigned int vfree = 0, nvfree = 0;
-    igraph_vector_int_init(&res, 0);
-    igraph_vector_int_init(&v, 0);
-    igraph_get_all_simple_paths(graph, &res, vertex1_id, igraph_vss_1(vertex2_id), -1, IGRAPH_ALL);
+float cga_degree_freedom_path(cga_graph_t *graph, igraph_integer_t vertex1_id, igraph_integer_t vertex2_id, unsigned int *num_vfree, unsigned int *num_novfree) {
+    return cga_degree_freedom_path_opts(graph, vertex1_id, vertex2_id, num_vfree, num_novfree, NULL, NULL);
+}
 
-    for (long i = 0; i < igraph_vector_int_size(&res); i++) {
-        if (VECTOR(res)[i] != -1) {
-            igraph_vector_int_push_back(&v, VECTOR(res)[i]);
-        } else {
-            cga_is_valley_free(graph, &v) ? vfree++ : nvfree++;
-            igraph_vector_int_clear(&v);
-        }
-    }
+float cga_degree_freedom_path_opts(cga_graph_t *graph, igraph_integer_t vertex1_id, igraph_integer_t vertex2_id, unsigned int *num_vfree, unsigned int *num_novfree, int *truncated, const cga_search_opts_t *opts) {
+    const cga_dfs_limits_t *limits = (opts != NULL) ? &opts->limits : NULL;
+    uint64_t vfree = 0, nvfree = 0;
+    int res = count_simple_paths(graph, vertex1_id, vertex2_id, limits, &vfree, &nvfree);
     if (num_vfree != NULL) *num_vfree = vfree;
     if (num_novfree != NULL) *num_novfree = nvfree;
-    igraph_vector_int_destroy(&res);
-    igraph_vector_int_destroy(&v);
+    if (truncated != NULL) *truncated = (res == CGA_DFS_TRUNCATED);
     return vfree / (float)nvfree;
 }
 
-cga_status_t cga_as_analysis(igraph_t *graph, igraph_integer_t vertex, unsigned int nthreads, char *filename) {
-    struct tinfo *ti = calloc(nthreads, sizeof(struct tinfo));
-    if (ti == NULL)
+/**
+ * Counts the simple paths between from and to, split in valley free and not valley free, with a
+ * single DFS that doesn't build the paths: each frame of the stack only keeps its vertex, the
+ * cursor in its adjacency list and the state of the valley free automaton, so the memory used
+ * is bounded by the depth of the search.
+ * Once the automaton state is -1 it stays -1, so the completions of an invalid prefix are still
+ * enumerated one by one, but counted as not valley free without stepping the automaton on their
+ * hops. The paths reaching to are counted without pushing a frame, and the stub ASes (one
+ * neighbor, the vertex the path comes from) are never entered, since a simple path can't leave
+ * them.
+ * 
+ * Arguments:
+ * graph: Pointer to the graph object
+ * from: The starting vertex_id
+ * to: The ending vertex_id
+ * limits: Pointer to the limits of the search, NULL if the search is not limited
+ * vfree: Pointer where the number of valley free paths is stored
+ * nvfree: Pointer where the number of not valley free paths is stored
+ * 
+ * Returns CGA_DFS_TRUNCATED if some paths have been cut by the limits, CGA_DFS_DONE otherwise
+ */
+static int count_simple_paths(cga_graph_t *graph, uint32_t from, uint32_t to, const cga_dfs_limits_t *limits, uint64_t *vfree, uint64_t *nvfree) {
+    *vfree = *nvfree = 0;
+    if (from == to) {  // the empty path
+        *vfree = 1;
+        return CGA_DFS_DONE;
+    }
+    cga_visited_t used_nodes;
+    size_t depth = (size_t)cga_graph_vcount(graph) + 1;
+    uint32_t *vertex = malloc(depth * sizeof(uint32_t));
+    uint32_t *cursor = malloc(depth * sizeof(uint32_t));
+    int8_t *dfa_state = malloc(depth * sizeof(int8_t));
+    if (vertex == NULL || cursor == NULL || dfa_state == NULL || cga_vs_init(&used_nodes, cga_graph_vcount(graph)) != SUCCESS) {
+        fprintf(stderr, "%s", "Out of memory while allocating the search stacks. Aborting process...");
+        abort();
+    }
+    long max_hops = (limits != NULL) ? limits->max_hops : 0;
+    uint64_t budget = (limits != NULL) ? limits->budget : 0, expanded = 0;
+    uint64_t counters[2] = {0, 0};  // valley free, not valley free
+    int res = CGA_DFS_DONE;
+    long top = 0;
+    vertex[0] = from;
+    cursor[0] = graph->offsets[from];
+    dfa_state[0] = 0;
+    cga_vs_insert(&used_nodes, from);
+    while (top >= 0) {
+        uint32_t v = vertex[top];
+        if (cursor[top] == graph->offsets[v + 1]) {  // all the neighbors are explored, backtrack
+            cga_vs_delete(&used_nodes, v);
+            top--;
+            continue;
+        }
+        uint32_t w = graph->adj[cursor[top]++];
+        uint32_t next = CGA_ADJ_VERTEX(w);
+        if (cga_vs_contains(&used_nodes, next)) continue;
+        int state = (dfa_state[top] < 0) ? -1 : cga_vf_state(dfa_state[top], CGA_ADJ_REL(w));
+        if (next == to) {
+            counters[state < 0]++;
+            continue;
+        }
+        if (cga_graph_degree(graph, next) == 1) continue;  // a stub AS, the path can't go on
+        if (max_hops > 0 && top + 1 >= max_hops) {  // the paths through next would be too long
+            res = CGA_DFS_TRUNCATED;
+            continue;
+        }
+        if (budget > 0 && ++expanded > budget) {  // budget exhausted
+            res = CGA_DFS_TRUNCATED;
+            break;
+        }
+        top++;
+        vertex[top] = next;
+        cursor[top] = graph->offsets[next];
+        dfa_state[top] = state;
+        cga_vs_insert(&used_nodes, next);
+    }
+    cga_vs_destroy(&used_nodes);
+    free(vertex);
+    free(cursor);
+    free(dfa_state);
+    *vfree = counters[0];
+    *nvfree = counters[1];
+    return res;
+}
+
+int cga_degree_freedom_visit(cga_graph_t *graph, igraph_integer_t vertex1_id, igraph_integer_t vertex2_id, cga_path_visitor_t visitor, void *arg) {
+    return cga_degree_freedom_visit_opts(graph, vertex1_id, vertex2_id, visitor, arg, NULL);
+}
+
+int cga_degree_freedom_visit_opts(cga_graph_t *graph, igraph_integer_t vertex1_id, igraph_integer_t vertex2_id, cga_path_visitor_t visitor, void *arg, const cga_search_opts_t *opts) {
+    const cga_dfs_limits_t *limits = (opts != NULL) ? &opts->limits : NULL;
+    cga_visited_t used_nodes;
+    if (cga_vs_init(&used_nodes, cga_graph_vcount(graph)) != SUCCESS) {
+        fprintf(stderr, "%s", "Out of memory while allocating the visited set. Aborting process...");
+        abort();
+    }
+    // the stacks have a frame for each vertex of curr_path, as in dfs_ctx_search; the automaton
+    // state -1 is kept once reached, so the subtree of an invalid prefix is still explored
+    size_t depth = (size_t)cga_graph_vcount(graph) + 1;
+    uint32_t *cursor = malloc(depth * sizeof(uint32_t));
+    int *dfa_state = malloc(depth * sizeof(int));
+    int *cost = malloc(depth * sizeof(int));
+    igraph_vector_int_t curr_path;
+    if (cursor == NULL || dfa_state == NULL || cost == NULL || igraph_vector_int_init(&curr_path, 0) != 0) {
+        fprintf(stderr, "%s", "Out of memory while allocating the search stacks. Aborting process...");
+        abort();
+    }
+    long max_hops = (limits != NULL) ? limits->max_hops : 0;
+    uint64_t budget = (limits != NULL) ? limits->budget : 0, expanded = 0;
+    int res = CGA_DFS_DONE;
+    long top = 0;
+    igraph_vector_int_push_back(&curr_path, vertex1_id);
+    cursor[0] = graph->offsets[vertex1_id];
+    dfa_state[0] = 0;
+    cost[0] = 0;
+    cga_vs_insert(&used_nodes, vertex1_id);
+    while (top >= 0 && res != CGA_DFS_STOPPED) {
+        igraph_integer_t last = VECTOR(curr_path)[top];
+        if (last == vertex2_id || cursor[top] == graph->offsets[last + 1]) {  // backtrack
+            if (last == vertex2_id) {
+                cga_path_view_t view = {VECTOR(curr_path), top, cost[top], dfa_state[top]};
+                if (visitor(graph, &view, arg) != 0) res = CGA_DFS_STOPPED;
+            }
+            cga_vs_delete(&used_nodes, last);
+            igraph_vector_int_pop_back(&curr_path);
+            top--;
+            continue;
+        }
+        uint32_t w = graph->adj[cursor[top]++];
+        igraph_integer_t next = CGA_ADJ_VERTEX(w);
+        if (cga_vs_contains(&used_nodes, next)) continue;
+        if (max_hops > 0 && top + 1 >= max_hops && next != vertex2_id) {  // the paths through next would be too long
+            res = CGA_DFS_TRUNCATED;
+            continue;
+        }
+        if (budget > 0 && ++expanded > budget) {  // budget exhausted
+            res = CGA_DFS_TRUNCATED;
+            break;
+        }
+        cga_vs_insert(&used_nodes, next);
+        igraph_vector_int_push_back(&curr_path, next);
+        top++;
+        cursor[top] = graph->offsets[next];
+        dfa_state[top] = (dfa_state[top - 1] < 0) ? -1 : cga_vf_state(dfa_state[top - 1], CGA_ADJ_REL(w));
+        cost[top] = cost[top - 1] + CGA_ADJ_REL(w);
+    }
+    cga_vs_destroy(&used_nodes);
+    igraph_vector_int_destroy(&curr_path);
+    free(cursor);
+    free(dfa_state);
+    free(cost);
+    return res;
+}
+
+cga_status_t cga_as_analysis(cga_graph_t *graph, igraph_integer_t vertex, unsigned int nthreads, char *filename) {
+    // one task for each first hop, weighted with the estimated size of its DFS subtree
+    uint32_t degree = cga_graph_degree(graph, vertex);
+    uint32_t *tasks = malloc((degree ? degree : 1) * sizeof(uint32_t));
+    uint64_t *weights = malloc((degree ? degree : 1) * sizeof(uint64_t));
+    if (tasks == NULL || weights == NULL) {
+        free(tasks);
+        free(weights);
         return NOMEM;
-    igraph_integer_t split = igraph_vcount(graph) / nthreads;
-    for (unsigned int i = 0; i < nthreads; i++) {
-        printf("Thread %d init\n", i);
-        ti[i].vertex = vertex;
-        ti[i].graph = graph;
-        int size = snprintf(NULL, 0, "%s_%u.csv", filename, i);
-        ti[i].filename = malloc(size + 1);
-        if (ti[i].filename == NULL) return NOMEM;
-        snprintf(ti[i].filename, size + 1, "%s_%u.csv", filename, i);
-        ti[i].lowerbound = split * i;
-        ti[i].upperbound = (i == (nthreads - 1)) ? igraph_vcount(graph) : split * (i + 1);
-        pthread_create(&ti[i].t_id, NULL, cga_as_analysis_job, &ti[i]);
     }
-    for (unsigned int i = 0; i < nthreads; i++) {
-        pthread_join(ti[i].t_id, NULL);
-        printf("Thread T%d finished\n", i);
-        free(ti[i].filename);
-        printf("Freed%d\n", i);
+    for (uint32_t i = 0; i < degree; i++) {
+        tasks[i] = i;
+        weights[i] = vertex_weight(graph, CGA_ADJ_VERTEX(graph->adj[graph->offsets[vertex] + i]));
     }
-    printf("Job finished\n");
-    free(ti);
-    return SUCCESS;
+    cga_sched_t *sched = cga_sched_init(nthreads, tasks, weights, degree);
+    free(tasks);
+    free(weights);
+    if (sched == NULL)
+        return NOMEM;
+    cga_status_t status = run_analysis(graph, vertex, nthreads, filename, sched, NULL, NULL, NULL, cga_as_analysis_job);
+    cga_sched_destroy(sched);
+    return status;
 }
 
 static void *cga_as_analysis_job(void *attr) {
     struct tinfo *ti = (struct tinfo *)attr;
-    igraph_lazy_adjlist_t adjlist;
-    igraph_vector_int_t res, path;
-    igraph_lazy_adjlist_init(ti->graph, &adjlist, IGRAPH_ALL, 1);
-    igraph_vector_int_init(&res, 0);
-    igraph_vector_int_init(&path, 0);
-
-    FILE *fp = fopen(ti->filename, "w+");
-    if (fp == NULL) {
-        printf("No output\n");
-        exit(EXIT_FAILURE);
-    }
-    printf("Open file \n");
-    fprintf(fp, "from, to, length, cost\n");
-    for (igraph_integer_t i = ti->lowerbound; i < ti->upperbound; i++) {
-        igraph_vector_t *neighbors = igraph_lazy_adjlist_get(&adjlist, i);
-        if ((igraph_vector_size(neighbors) == 0) || (i == ti->vertex)) continue;
-        cga_dfs_vfree_it(ti->graph, &res, ti->vertex, i);
-        for (long j = 0; j < igraph_vector_int_size(&res); j++) {
-            if (VECTOR(res)[j] != -1) {
-                igraph_vector_int_push_back(&path, VECTOR(res)[j]);
-            } else {
-                if (igraph_vector_int_size(&path) == 0) continue;  // no path between the two nodes
-                int pathc = cga_path_cost(ti->graph, &path);
-                fprintf(fp, "%lu,%lu,%li,%d\n", (unsigned long)VAN(ti->graph, "label", ti->vertex), (unsigned long)VAN(ti->graph, "label", i), igraph_vector_int_size(&path) - 1, pathc);
-                igraph_vector_int_clear(&path);
+
+    cga_writer_t out;
+    if ((ti->status = cga_writer_open(&out, ti->filename)) != SUCCESS)
+        return NULL;
+    cga_writer_puts(&out, "from, to, length, cost\n");
+    cga_dfs_ctx_t *ctx = cga_dfs_ctx_init(ti->graph);
+    if (ctx == NULL) {
+        fprintf(stderr, "%s", "Out of memory while allocating the DFS context. Aborting process...");
+        abort();
+    }
+    uint32_t first_hop;
+    while (cga_sched_next(ti->sched, ti->worker, &first_hop)) {
+        dfs_ctx_search(ctx, ti->vertex, -1, first_hop, first_hop + 1, print_path_row, &out);
+    }
+    cga_dfs_ctx_destroy(ctx);
+    ti->status = cga_writer_close(&out);
+    return NULL;
+}
+
+cga_status_t cga_graph_analysis(cga_graph_t *graph, unsigned int nthreads, char *filename) {
+    return cga_graph_analysis_opts(graph, nthreads, filename, NULL);
+}
+
+void cga_analysis_opts_init(cga_analysis_opts_t *opts) {
+    opts->symmetric = 0;
+    opts->consolidated = 0;
+    opts->binary = 0;
+    opts->indexed = 0;
+    opts->checkpoint_interval = 0;
+    opts->resume = 0;
+    opts->limits.max_hops = 0;
+    opts->limits.budget = 0;
+}
+
+cga_status_t cga_graph_analysis_opts(cga_graph_t *graph, unsigned int nthreads, char *filename, const cga_analysis_opts_t *opts) {
+    cga_analysis_opts_t defaults;
+    if (opts == NULL) {
+        cga_analysis_opts_init(&defaults);
+        opts = &defaults;
+    }
+    if (opts->indexed && !opts->binary) {  // the indexed file is built from the binary files
+        defaults = *opts;
+        defaults.binary = 1;
+        opts = &defaults;
+    }
+    int checkpointed = opts->checkpoint_interval > 0 || opts->resume;
+    if (opts->consolidated && checkpointed)  // the consolidated file has no manifests to resume from
+        return WRFORMAT;
+    analysis_ckpt_t *ckpts = NULL;
+    uint8_t *skip = NULL;  // the targets completed by the resumed run
+    if (checkpointed) {
+        cga_status_t status;
+        ckpts = ckpts_init(graph, filename, nthreads, opts, &skip, &status);
+        if (ckpts == NULL)
+            return status;
+    }
+    cga_sched_t *sched = vertices_sched(graph, nthreads, 1, opts->symmetric, skip);
+    free(skip);
+    if (sched == NULL) {
+        ckpts_destroy(ckpts, nthreads);
+        return NOMEM;
+    }
+    cga_output_t *output = NULL;
+    if (opts->consolidated) {  // a single file filename.csv written by a dedicated thread
+        int limited = opts->limits.max_hops > 0 || opts->limits.budget > 0;
+        const char *ext = opts->binary ? CGA_PAIRS_EXT : "csv";
+        int size = snprintf(NULL, 0, "%s.%s", filename, ext);
+        char *path = malloc(size + 1);
+        if (path == NULL) {
+            cga_sched_destroy(sched);
+            return NOMEM;
+        }
+        snprintf(path, size + 1, "%s.%s", filename, ext);
+        cga_status_t status;
+        if (opts->binary) {
+            cga_pairs_header_t header;
+            cga_pairs_header_init(&header, graph, (limited ? CGA_PAIRS_LIMITED : 0) | (opts->symmetric ? CGA_PAIRS_SYMMETRIC : 0));
+            status = cga_output_open(&output, path, &header, sizeof(header), nthreads, sizeof(pair_record_t), 0, format_pair_record_binary, graph);
+        } else {
+            const char *header = pair_header(limited);
+            status = cga_output_open(&output, path, header, strlen(header), nthreads, sizeof(pair_record_t), 0, format_pair_record, graph);
+        }
+        free(path);
+        if (status != SUCCESS) {
+            cga_sched_destroy(sched);
+            return status;
+        }
+    }
+    cga_status_t status = run_analysis(graph, 0, nthreads, filename, sched, opts, output, ckpts, cga_graph_analysis_job);
+    ckpts_destroy(ckpts, nthreads);
+    if (output != NULL) {
+        cga_status_t written = cga_output_close(output);
+        if (status == SUCCESS) status = written;
+    }
+    cga_sched_destroy(sched);
+    if (status == SUCCESS && opts->indexed)
+        status = build_result(filename, nthreads, opts->consolidated);
+    return status;
+}
+
+static void *cga_graph_analysis_job(void *attr) {
+    struct tinfo *ti = (struct tinfo *)attr;
+
+    // the truncated column is printed only when the searches are limited
+    int limited = ti->opts->limits.max_hops > 0 || ti->opts->limits.budget > 0;
+    cga_writer_t out;
+    if (ti->ckpt != NULL && ti->ckpt->resumed) {  // go on after the rows of the last checkpoint
+        if ((ti->status = cga_writer_resume(&out, ti->filename, ti->ckpt->header.offset)) != SUCCESS)
+            return NULL;
+    } else if (ti->output == NULL) {
+        if ((ti->status = cga_writer_open(&out, ti->filename)) != SUCCESS)
+            return NULL;
+        if (ti->opts->binary)
+            write_pairs_header(&out, ti->graph, ti->opts);
+        else
+            cga_writer_puts(&out, pair_header(limited));
+    }
+    cga_dfs_ctx_t *ctx = cga_dfs_ctx_init(ti->graph);
+    if (ctx == NULL) {
+        fprintf(stderr, "%s", "Out of memory while allocating the DFS context. Aborting process...");
+        abort();
+    }
+    cga_dfs_ctx_set_limits(ctx, &ti->opts->limits);
+    int symmetric = ti->opts->symmetric;
+    uint32_t j;
+    while (cga_sched_next(ti->sched, ti->worker, &j)) {
+        // the pairs are searched target by target, so the reachability table of j is computed once
+        cga_dfs_ctx_set_target(ctx, j);
+        uint64_t searched = 0;
+        // in symmetric mode the pair <i, j> with i > j is analyzed as the pair <j, i>
+        for (uint32_t i = 0; i < (symmetric ? j : cga_graph_vcount(ti->graph)); i++) {
+            if (i == j) continue;  // same node, not needed for analysis
+            if (cga_graph_degree(ti->graph, i) == 0) continue;  // the node is unreachable
+            if (!cga_dfs_ctx_reachable(ctx, i, j)) continue;  // there's no valley free path
+            searched++;
+            cga_pair_stats_t stats;
+            cga_pair_stats_init(&stats);
+            int truncated = cga_dfs_ctx_visit_it(ctx, i, j, cga_pair_stats_visitor, &stats) == CGA_DFS_TRUNCATED;
+            if (stats.count == 0 && !truncated) continue;  // if count is 0 there's no paths between two nodes
+            if (ti->output != NULL) {
+                pair_record_t record = {i, j, limited ? truncated : -1, symmetric, stats};
+                cga_output_push(ti->output, ti->worker, &record);
+                continue;
+            }
+            if (ti->opts->binary) {  // the reversed row of the symmetric mode is implied
+                write_pair_binary(&out, ti->graph, i, j, &stats, truncated);
+                continue;
+            }
+            print_pair_row(&out, ti->graph, i, j, &stats, 0, limited ? truncated : -1);
+            if (symmetric) print_pair_row(&out, ti->graph, j, i, &stats, 1, limited ? truncated : -1);
+        }
+        cga_stats_add(CGA_STAT_PAIRS, searched);
+        cga_stats_add(CGA_STAT_SOURCES, 1);
+        if (ti->ckpt != NULL)
+            ckpt_task_done(ti->ckpt, j, &out, ti->opts->checkpoint_interval);
+    }
+    if (ti->ckpt != NULL)  // a complete manifest, so resuming a finished run does nothing
+        ckpt_save(ti->ckpt, &out);
+    cga_dfs_ctx_destroy(ctx);
+    if (ti->output == NULL)
+        ti->status = cga_writer_close(&out);
+    return NULL;
+}
+
+cga_status_t cga_graph_analysis_shortest(cga_graph_t *graph, unsigned int nthreads, char *filename) {
+    cga_sched_t *sched = vertices_sched(graph, nthreads, 0, 0, NULL);  // every BFS costs O(V + E)
+    if (sched == NULL)
+        return NOMEM;
+    cga_status_t status = run_analysis(graph, 0, nthreads, filename, sched, NULL, NULL, NULL, cga_graph_analysis_shortest_job);
+    cga_sched_destroy(sched);
+    return status;
+}
+
+static void *cga_graph_analysis_shortest_job(void *attr) {
+    struct tinfo *ti = (struct tinfo *)attr;
+    cga_writer_t out;
+    if ((ti->status = cga_writer_open(&out, ti->filename)) != SUCCESS)
+        return NULL;
+    vf_bfs_t bfs;
+    if (vf_bfs_init(&bfs, cga_graph_vcount(ti->graph)) != 0) {
+        fprintf(stderr, "%s", "Out of memory while allocating the search buffers. Aborting process...");
+        abort();
+    }
+
+    cga_writer_puts(&out, "from, to, length, min cost, max cost, paths\n");
+    uint32_t i;
+    while (cga_sched_next(ti->sched, ti->worker, &i)) {
+        vf_bfs_run(ti->graph, &bfs, i);
+        uint64_t reached = 0;
+        for (uint32_t j = 0; j < cga_graph_vcount(ti->graph); j++) {
+            if (j == i) continue;  // same node, not needed for analysis
+            int32_t d0 = bfs.dist[2 * j], d1 = bfs.dist[2 * j + 1];
+            if (d0 < 0 && d1 < 0) continue;  // there's no valley free path between the two nodes
+            reached++;
+            int32_t length = (d0 < 0) ? d1 : (d1 < 0 || d0 < d1) ? d0 : d1;
+            uint64_t count = 0;
+            int cost_min = INT_MAX, cost_max = INT_MIN;
+            for (uint32_t k = 2 * j; k <= 2 * j + 1; k++) {
+                if (bfs.dist[k] != length) continue;
+                count = (count + bfs.count[k] < count) ? UINT64_MAX : count + bfs.count[k];
+                if (bfs.cost_min[k] < cost_min) cost_min = bfs.cost_min[k];
+                if (bfs.cost_max[k] > cost_max) cost_max = bfs.cost_max[k];
             }
+            cga_writer_uint(&out, cga_graph_label(ti->graph, i));
+            cga_writer_putc(&out, ',');
+            cga_writer_uint(&out, cga_graph_label(ti->graph, j));
+            cga_writer_putc(&out, ',');
+            cga_writer_int(&out, length);
+            cga_writer_putc(&out, ',');
+            cga_writer_int(&out, cost_min);
+            cga_writer_putc(&out, ',');
+            cga_writer_int(&out, cost_max);
+            cga_writer_putc(&out, ',');
+            cga_writer_uint(&out, count);
+            cga_writer_putc(&out, '\n');
         }
-        igraph_vector_int_clear(&res);
+        cga_stats_add(CGA_STAT_PAIRS, reached);
+        cga_stats_add(CGA_STAT_SOURCES, 1);
     }
-    fclose(fp);
-    printf("file close\n");
-    igraph_lazy_adjlist_destroy(&adjlist);
-    printf("prova1\n");
-    igraph_vector_int_destroy(&path);
-    printf("prova2\n");
-    igraph_vector_int_destroy(&res);
-    printf("prova3\n");
+    ti->status = cga_writer_close(&out);
+    vf_bfs_destroy(&bfs);
     return NULL;
 }
 
-cga_status_t cga_graph_analysis(igraph_t *graph, unsigned int nthreads, char *filename) {
+/**
+ * Prints the <from, to, avg length, min length, max length, avg cost, min cost, max cost> row of
+ * the paths aggregated in stats. If reversed is not 0, stats aggregates the paths from to to from,
+ * so the costs are negated (and the minimum is swapped with the maximum).
+ * If truncated is not negative it is printed as a further column; a truncated pair without paths
+ * has empty statistics.
+ */
+static void print_pair_row(cga_writer_t *out, cga_graph_t *graph, uint32_t from, uint32_t to, const cga_pair_stats_t *stats, int reversed, int truncated) {
+    int64_t cost_sum = reversed ? -stats->cost_sum : stats->cost_sum;
+    int cost_min = reversed ? -stats->cost_max : stats->cost_min;
+    int cost_max = reversed ? -stats->cost_min : stats->cost_max;
+    cga_writer_uint(out, cga_graph_label(graph, from));
+    cga_writer_putc(out, ',');
+    cga_writer_uint(out, cga_graph_label(graph, to));
+    if (stats->count == 0) {
+        cga_writer_write(out, ",,,,,,", 6);
+    } else {
+        cga_writer_putc(out, ',');
+        cga_writer_fixed(out, stats->length_sum / (float)stats->count, 3);
+        cga_writer_putc(out, ',');
+        cga_writer_int(out, stats->length_min);
+        cga_writer_putc(out, ',');
+        cga_writer_int(out, stats->length_max);
+        cga_writer_putc(out, ',');
+        cga_writer_fixed(out, cost_sum / (float)stats->count, 3);
+        cga_writer_putc(out, ',');
+        cga_writer_int(out, cost_min);
+        cga_writer_putc(out, ',');
+        cga_writer_int(out, cost_max);
+    }
+    if (truncated >= 0) {
+        cga_writer_putc(out, ',');
+        cga_writer_int(out, truncated);
+    }
+    cga_writer_putc(out, '\n');
+}
+
+/**
+ * Header of the files of cga_graph_analysis, with the truncated column if limited is not 0
+ */
+static const char *pair_header(int limited) {
+    return limited ? CGA_PAIRS_CSV_HEADER_LIMITED : CGA_PAIRS_CSV_HEADER;
+}
+
+/**
+ * Writes the header of a binary result file of cga_graph_analysis run with opts
+ */
+static void write_pairs_header(cga_writer_t *out, const cga_graph_t *graph, const cga_analysis_opts_t *opts) {
+    int limited = opts->limits.max_hops > 0 || opts->limits.budget > 0;
+    cga_pairs_header_t header;
+    cga_pairs_header_init(&header, graph, (limited ? CGA_PAIRS_LIMITED : 0) | (opts->symmetric ? CGA_PAIRS_SYMMETRIC : 0));
+    cga_writer_write(out, (const char *)&header, sizeof(header));
+}
+
+/**
+ * Writes the binary record of the pair <from, to>
+ */
+static void write_pair_binary(cga_writer_t *out, const cga_graph_t *graph, uint32_t from, uint32_t to, const cga_pair_stats_t *stats, int truncated) {
+    cga_pair_record_t record;
+    cga_pair_record_init(&record, graph, from, to, stats, truncated);
+    cga_writer_write(out, (const char *)&record, sizeof(record));
+}
+
+/**
+ * cga_record_format_t of the pair_record_t of cga_graph_analysis; arg is the graph
+ */
+static void format_pair_record(cga_writer_t *out, const void *record, void *arg) {
+    const pair_record_t *rec = (const pair_record_t *)record;
+    print_pair_row(out, (cga_graph_t *)arg, rec->from, rec->to, &rec->stats, 0, rec->truncated);
+    if (rec->symmetric) print_pair_row(out, (cga_graph_t *)arg, rec->to, rec->from, &rec->stats, 1, rec->truncated);
+}
+
+/**
+ * Prepares the checkpoint state of the nthreads threads of cga_graph_analysis. If opts->resume
+ * is set the manifests of the previous run are loaded and the targets they completed are marked
+ * in *skip (an array of vcount flags, NULL if there's nothing to skip); otherwise the manifests
+ * of previous runs are removed, so they can't be mistaken for the ones of this run.
+ *
+ * Returns the array of the states, NULL with the reason in status if the manifests can't be used
+ */
+static analysis_ckpt_t *ckpts_init(cga_graph_t *graph, const char *filename, unsigned int nthreads, const cga_analysis_opts_t *opts, uint8_t **skip, cga_status_t *status) {
+    *skip = NULL;
+    analysis_ckpt_t *ckpts = calloc(nthreads, sizeof(analysis_ckpt_t));
+    if (ckpts == NULL) {
+        *status = NOMEM;
+        return NULL;
+    }
+    uint64_t fingerprint = cga_graph_fingerprint(graph), order = graph_order_id(graph), options = analysis_options_id(opts);
+    *status = SUCCESS;
+    for (unsigned int i = 0; i < nthreads && *status == SUCCESS; i++) {
+        analysis_ckpt_t *ckpt = &ckpts[i];
+        clock_gettime(CLOCK_MONOTONIC, &ckpt->last);
+        int size = snprintf(NULL, 0, "%s_%u.%s", filename, i, CGA_CHECKPOINT_EXT);
+        ckpt->manifest = malloc(size + 1);
+        if (ckpt->manifest == NULL) {
+            *status = NOMEM;
+            break;
+        }
+        snprintf(ckpt->manifest, size + 1, "%s_%u.%s", filename, i, CGA_CHECKPOINT_EXT);
+        cga_checkpoint_header_init(&ckpt->header, fingerprint, order, options, i, nthreads);
+        if (!opts->resume) {
+            remove(ckpt->manifest);
+            continue;
+        }
+        cga_checkpoint_header_t header;
+        uint32_t *done;
+        cga_status_t loaded = cga_checkpoint_load(ckpt->manifest, &header, &done);
+        if (loaded == NFOUND)  // the thread had not reached its first checkpoint
+            continue;
+        if (loaded == SUCCESS && (header.fingerprint != fingerprint || header.order != order || header.options != options || header.worker != i || header.nworkers != nthreads)) {
+            free(done);
+            loaded = WRFORMAT;
+        }
+        if (loaded != SUCCESS) {
+            *status = loaded;
+            break;
+        }
+        if (*skip == NULL && (*skip = calloc(cga_graph_vcount(graph) ? cga_graph_vcount(graph) : 1, sizeof(uint8_t))) == NULL) {
+            free(done);
+            *status = NOMEM;
+            break;
+        }
+        for (uint64_t k = 0; k < header.ndone; k++) {
+            if (done[k] >= cga_graph_vcount(graph)) {
+                *status = WRFORMAT;
+                break;
+            }
+            (*skip)[done[k]] = 1;
+        }
+        ckpt->header = header;
+        ckpt->done = done;
+        ckpt->size = header.ndone;
+        ckpt->resumed = 1;
+    }
+    if (*status != SUCCESS) {
+        ckpts_destroy(ckpts, nthreads);
+        free(*skip);
+        *skip = NULL;
+        return NULL;
+    }
+    return ckpts;
+}
+
+/**
+ * Frees the checkpoint states created by ckpts_init. ckpts can be NULL.
+ */
+static void ckpts_destroy(analysis_ckpt_t *ckpts, unsigned int nthreads) {
+    if (ckpts == NULL)
+        return;
+    for (unsigned int i = 0; i < nthreads; i++) {
+        free(ckpts[i].manifest);
+        free(ckpts[i].done);
+    }
+    free(ckpts);
+}
+
+/**
+ * Records that the thread has written all the rows of task, and takes a checkpoint if interval
+ * seconds have passed since the last one.
+ */
+static void ckpt_task_done(analysis_ckpt_t *ckpt, uint32_t task, cga_writer_t *out, double interval) {
+    if (ckpt->header.ndone == ckpt->size) {
+        uint64_t size = ckpt->size ? 2 * ckpt->size : 1024;
+        uint32_t *done = realloc(ckpt->done, size * sizeof(uint32_t));
+        if (done == NULL) {
+            fprintf(stderr, "%s", "Out of memory while recording a checkpoint. Aborting process...");
+            abort();
+        }
+        ckpt->done = done;
+        ckpt->size = size;
+    }
+    ckpt->done[ckpt->header.ndone++] = task;
+    if (interval <= 0)
+        return;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if ((now.tv_sec - ckpt->last.tv_sec) + (now.tv_nsec - ckpt->last.tv_nsec) * 1e-9 >= interval)
+        ckpt_save(ckpt, out);
+}
+
+/**
+ * Takes a checkpoint: flushes the output file to the disk, then writes the manifest with the
+ * size of the file and the tasks completed. A failed checkpoint is reported and the run goes
+ * on: the previous manifest is still valid.
+ */
+static void ckpt_save(analysis_ckpt_t *ckpt, cga_writer_t *out) {
+    clock_gettime(CLOCK_MONOTONIC, &ckpt->last);
+    if (cga_writer_sync(out) != SUCCESS) {
+        fprintf(stderr, "Error while writing the checkpoint %s\n", ckpt->manifest);
+        return;
+    }
+    ckpt->header.offset = out->written;
+    if (cga_checkpoint_save(ckpt->manifest, &ckpt->header, ckpt->done) != SUCCESS)
+        fprintf(stderr, "Error while writing the checkpoint %s\n", ckpt->manifest);
+}
+
+/**
+ * Identifies the options that change the content of the output files of cga_graph_analysis,
+ * so a run is only resumed with the same ones.
+ */
+static uint64_t analysis_options_id(const cga_analysis_opts_t *opts) {
+    uint64_t id = cga_hash_int((opts->symmetric ? 1 : 0) | (opts->binary ? 2 : 0));
+    id = cga_hash_int(id ^ (uint64_t)opts->limits.max_hops);
+    return cga_hash_int(id ^ opts->limits.budget);
+}
+
+/**
+ * Identifies the vertex_ids of the graph, i.e. the as_number of each of them in order: the
+ * manifests store vertex_ids, so a run is only resumed on a graph with the same ones.
+ */
+static uint64_t graph_order_id(const cga_graph_t *graph) {
+    uint64_t id = cga_hash_int(graph->vcount);
+    for (uint32_t v = 0; v < graph->vcount; v++)
+        id = cga_hash_int(id ^ graph->labels[v]);
+    return id;
+}
+
+/**
+ * Merges the binary files of a run of cga_graph_analysis, filename_n for n in [0, nfiles) or
+ * filename if consolidated, in the indexed result file filename.CGA_RESULT_EXT
+ */
+static cga_status_t build_result(const char *filename, unsigned int nfiles, int consolidated) {
+    if (consolidated) nfiles = 1;
+    char **paths = calloc(nfiles + 1, sizeof(char *));  // the last one is the indexed file
+    if (paths == NULL)
+        return NOMEM;
+    cga_status_t status = SUCCESS;
+    for (unsigned int i = 0; i <= nfiles && status == SUCCESS; i++) {
+        int size;
+        if (i == nfiles)
+            size = snprintf(NULL, 0, "%s.%s", filename, CGA_RESULT_EXT);
+        else if (consolidated)
+            size = snprintf(NULL, 0, "%s.%s", filename, CGA_PAIRS_EXT);
+        else
+            size = snprintf(NULL, 0, "%s_%u.%s", filename, i, CGA_PAIRS_EXT);
+        paths[i] = malloc(size + 1);
+        if (paths[i] == NULL)
+            status = NOMEM;
+        else if (i == nfiles)
+            snprintf(paths[i], size + 1, "%s.%s", filename, CGA_RESULT_EXT);
+        else if (consolidated)
+            snprintf(paths[i], size + 1, "%s.%s", filename, CGA_PAIRS_EXT);
+        else
+            snprintf(paths[i], size + 1, "%s_%u.%s", filename, i, CGA_PAIRS_EXT);
+    }
+    if (status == SUCCESS)
+        status = cga_result_build((const char *const *)paths, nfiles, paths[nfiles]);
+    for (unsigned int i = 0; i <= nfiles; i++)
+        free(paths[i]);
+    free(paths);
+    return status;
+}
+
+/**
+ * cga_record_format_t writing the pair_record_t of cga_graph_analysis in the binary format of
+ * pairs.h; arg is the graph
+ */
+static void format_pair_record_binary(cga_writer_t *out, const void *record, void *arg) {
+    const pair_record_t *rec = (const pair_record_t *)record;
+    write_pair_binary(out, (const cga_graph_t *)arg, rec->from, rec->to, &rec->stats, rec->truncated > 0);
+}
+
+/**
+ * Starts nthreads threads running job, each one with its own output file filename_n.csv (with
+ * the extension CGA_PAIRS_EXT if opts->binary is set) and its own worker index in sched, and
+ * waits for all of them to finish.
+ * opts is given to the jobs that need it, it can be NULL for the others. If output is not NULL
+ * the jobs push their results there (the worker index is also the producer index) instead of
+ * writing their own files. ckpts, if not NULL, holds the checkpoint state of each thread.
+ * Returns NOMEM if the threads can't be started, otherwise the status of the first job whose
+ * output file couldn't be opened or written (SUCCESS if all of them were).
+ */
+static cga_status_t run_analysis(cga_graph_t *graph, igraph_integer_t vertex, unsigned int nthreads, char *filename, cga_sched_t *sched, const cga_analysis_opts_t *opts, cga_output_t *output, analysis_ckpt_t *ckpts, void *(*job)(void *)) {
     struct tinfo *ti = calloc(nthreads, sizeof(struct tinfo));
     if (ti == NULL)
         return NOMEM;
-    igraph_integer_t split = igraph_vcount(graph) / nthreads;
+    cga_stats_phase_begin(CGA_PHASE_ANALYZE);
+    unsigned int started = 0;
+    cga_status_t status = SUCCESS;
     for (unsigned int i = 0; i < nthreads; i++) {
+        ti[i].vertex = vertex;
         ti[i].graph = graph;
-        int size = snprintf(NULL, 0, "%s_%u.csv", filename, i);
+        ti[i].sched = sched;
+        ti[i].worker = i;
+        ti[i].opts = opts;
+        ti[i].output = output;
+        ti[i].ckpt = ckpts != NULL ? &ckpts[i] : NULL;
+        const char *ext = (opts != NULL && opts->binary) ? CGA_PAIRS_EXT : "csv";
+        int size = snprintf(NULL, 0, "%s_%u.%s", filename, i, ext);
         ti[i].filename = malloc(size + 1);
-        if (ti[i].filename == NULL) return NOMEM;
-        snprintf(ti[i].filename, size + 1, "%s_%u.csv", filename, i);
-        ti[i].lowerbound = split * i;
-        ti[i].upperbound = (i == (nthreads - 1)) ? igraph_vcount(graph) : split * (i + 1);
-        pthread_create(&ti[i].t_id, NULL, cga_graph_analysis_job, &ti[i]);
+        if (ti[i].filename == NULL) {
+            status = NOMEM;
+            break;
+        }
+        snprintf(ti[i].filename, size + 1, "%s_%u.%s", filename, i, ext);
+        if (pthread_create(&ti[i].t_id, NULL, job, &ti[i]) != 0) {
+            status = NOMEM;
+            break;
+        }
+        started++;
     }
-    for (int i = 0; i < nthreads; i++) {
+    for (unsigned int i = 0; i < started; i++) {
         pthread_join(ti[i].t_id, NULL);
+        if (status == SUCCESS)  // the first job whose output is incomplete
+            status = ti[i].status;
+    }
+    cga_stats_phase_end(CGA_PHASE_ANALYZE);
+    for (unsigned int i = 0; i < nthreads; i++) {
         free(ti[i].filename);
     }
     free(ti);
-    return SUCCESS;
+    return status;
 }
 
-static void *cga_graph_analysis_job(void *attr) {
-    struct tinfo *ti = (struct tinfo *)attr;
-    igraph_lazy_adjlist_t adjlist;
-    igraph_vector_int_t res, path;
-    igraph_lazy_adjlist_init(ti->graph, &adjlist, IGRAPH_ALL, 1);
-    igraph_vector_int_init(&res, 0);
-    igraph_vector_int_init(&path, 0);
-
-    FILE *fp = fopen(ti->filename, "w+");
-    if (fp == NULL) {
-        printf("No output\n");
-        exit(EXIT_FAILURE);
-    }
-    printf("Open file \n");
-    fprintf(fp, "from, to, avg length, min length, max length, avg cost, min cost, max cost\n");
-    for (igraph_integer_t i = ti->lowerbound; i < ti->upperbound; i++) {
-        igraph_vector_t *outervect = igraph_lazy_adjlist_get(&adjlist, i);
-        if (igraph_vector_size(outervect) == 0) continue;  // the node is unreachable
-        for (igraph_integer_t j = 0; j < igraph_vcount(ti->graph); j++) {
-            if (j == i) continue;  // same node, not needed for analysis
-            igraph_vector_t *innervect = igraph_lazy_adjlist_get(&adjlist, j);
-            if (igraph_vector_size(innervect) == 0) continue;  // the node is unreachable
-            int cost_sum = 0, cost_min = INT_MAX, cost_max = INT_MIN, length_sum = 0, length_min = INT_MAX, length_max = INT_MIN, count = 0;
-            cga_dfs_vfree_it(ti->graph, &res, i, j);
-            for (long k = 0; k < igraph_vector_int_size(&res); k++) {
-                if (VECTOR(res)[k] != -1) {
-                    igraph_vector_int_push_back(&path, VECTOR(res)[k]);
-                } else {
-                    int pathc = cga_path_cost(ti->graph, &path);
-                    cost_sum += pathc;
-                    count++;
-                    if (pathc < cost_min) cost_min = pathc;
-                    if (pathc > cost_max) cost_max = pathc;
-                    int size = igraph_vector_int_size(&path) - 1;
-                    length_sum += size;
-                    if (size < length_min) length_min = size;
-                    if (size > length_max) length_max = size;
-                    igraph_vector_int_clear(&path);
-                }
-            }
-            if (count != 0) {  // if count is 0 there's no paths between two nodes
-                fprintf(fp, "%lu,%lu,%.3f,%d,%d,%.3f,%d,%d\n", (unsigned long)VAN(ti->graph, "label", i), (unsigned long)VAN(ti->graph, "label", j),
-                        length_sum / (float)count, length_min, length_max, cost_sum / (float)count, cost_min, cost_max);
+/**
+ * Creates a scheduler with one task for each vertex that has at least a neighbor.
+ * If weighted is not 0, the tasks are ordered by vertex_weight, the largest first.
+ * If lower is not 0, each vertex is only paired with the vertices with a lower vertex_id, so
+ * its weight is scaled by the number of those vertices.
+ * The vertices v with skip[v] not 0 are left out, skip can be NULL.
+ */
+static cga_sched_t *vertices_sched(cga_graph_t *graph, unsigned int nthreads, int weighted, int lower, const uint8_t *skip) {
+    uint32_t vcount = cga_graph_vcount(graph), ntasks = 0;
+    uint32_t *tasks = malloc((vcount ? vcount : 1) * sizeof(uint32_t));
+    uint64_t *weights = weighted ? malloc((vcount ? vcount : 1) * sizeof(uint64_t)) : NULL;
+    if (tasks == NULL || (weighted && weights == NULL)) {
+        free(tasks);
+        free(weights);
+        return NULL;
+    }
+    for (uint32_t v = 0; v < vcount; v++) {
+        if (cga_graph_degree(graph, v) == 0) continue;  // the node is unreachable
+        if (skip != NULL && skip[v]) continue;          // already done
+        if (weighted) weights[ntasks] = vertex_weight(graph, v) * (lower ? v + 1 : 1);
+        tasks[ntasks++] = v;
+    }
+    cga_sched_t *sched = cga_sched_init(nthreads, tasks, weights, ntasks);
+    free(tasks);
+    free(weights);
+    return sched;
+}
+
+/**
+ * Cheap estimate of the number of paths starting from (or ending in) v: the number of walks of length 2
+ * from v, i.e. the sum of the degrees of its neighbors.
+ */
+static uint64_t vertex_weight(cga_graph_t *graph, uint32_t v) {
+    uint64_t weight = 0;
+    for (uint32_t i = graph->offsets[v]; i < graph->offsets[v + 1]; i++)
+        weight += cga_graph_degree(graph, CGA_ADJ_VERTEX(graph->adj[i]));
+    return weight;
+}
+
+/**
+ * Allocates the buffers used by vf_bfs_run for a graph of vcount vertices.
+ * 
+ * Returns 0 if the operation completed without errors, -1 if there's not enough memory
+ */
+static int vf_bfs_init(vf_bfs_t *bfs, uint32_t vcount) {
+    size_t n = 2 * (size_t)vcount + 1;
+    bfs->dist = malloc(n * sizeof(int32_t));
+    bfs->count = malloc(n * sizeof(uint64_t));
+    bfs->cost_min = malloc(n * sizeof(int));
+    bfs->cost_max = malloc(n * sizeof(int));
+    bfs->queue = malloc(n * sizeof(uint32_t));
+    bfs->qlen = 0;
+    if (bfs->dist == NULL || bfs->count == NULL || bfs->cost_min == NULL || bfs->cost_max == NULL || bfs->queue == NULL) {
+        vf_bfs_destroy(bfs);
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) bfs->dist[i] = -1;
+    return 0;
+}
+
+static void vf_bfs_destroy(vf_bfs_t *bfs) {
+    free(bfs->dist);
+    free(bfs->count);
+    free(bfs->cost_min);
+    free(bfs->cost_max);
+    free(bfs->queue);
+}
+
+/**
+ * Breadth first search from source over the product graph <vertex, valley free state>.
+ * Since the automaton can only move from state 0 to state 1, a shortest walk in the product graph
+ * never visits the same vertex twice, so the distances are the lengths of the shortest valley free
+ * paths. Together with the distance, this function computes for each entry the number of shortest
+ * paths (saturated at UINT64_MAX) and the minimum and maximum cost among them.
+ * Only the entries touched by the previous run are reset, so each run costs O(V + E).
+ */
+static void vf_bfs_run(cga_graph_t *graph, vf_bfs_t *bfs, uint32_t source) {
+    for (uint32_t i = 0; i < bfs->qlen; i++)
+        bfs->dist[bfs->queue[i]] = -1;
+    uint32_t head = 0;
+    bfs->qlen = 0;
+    bfs->dist[2 * source] = 0;
+    bfs->count[2 * source] = 1;
+    bfs->cost_min[2 * source] = bfs->cost_max[2 * source] = 0;
+    bfs->queue[bfs->qlen++] = 2 * source;
+    while (head < bfs->qlen) {
+        uint32_t curr = bfs->queue[head++];
+        uint32_t v = curr / 2;
+        int state = curr % 2;
+        for (uint32_t i = graph->offsets[v]; i < graph->offsets[v + 1]; i++) {
+            uint32_t w = CGA_ADJ_VERTEX(graph->adj[i]);
+            int rel = CGA_ADJ_REL(graph->adj[i]);
+            int next_state = cga_vf_state(state, rel);
+            if (next_state == -1 || w == source) continue;
+            uint32_t next = 2 * w + next_state;
+            if (bfs->dist[next] == -1) {
+                bfs->dist[next] = bfs->dist[curr] + 1;
+                bfs->count[next] = bfs->count[curr];
+                bfs->cost_min[next] = bfs->cost_min[curr] + rel;
+                bfs->cost_max[next] = bfs->cost_max[curr] + rel;
+                bfs->queue[bfs->qlen++] = next;
+            } else if (bfs->dist[next] == bfs->dist[curr] + 1) {
+                uint64_t sum = bfs->count[next] + bfs->count[curr];
+                bfs->count[next] = (sum < bfs->count[next]) ? UINT64_MAX : sum;
+                if (bfs->cost_min[curr] + rel < bfs->cost_min[next]) bfs->cost_min[next] = bfs->cost_min[curr] + rel;
+                if (bfs->cost_max[curr] + rel > bfs->cost_max[next]) bfs->cost_max[next] = bfs->cost_max[curr] + rel;
             }
-            igraph_vector_int_clear(&res);
         }
     }
-    fclose(fp);
-    igraph_lazy_adjlist_destroy(&adjlist);
-    igraph_vector_int_destroy(&path);
-    igraph_vector_int_destroy(&res);
-    return NULL;
 }
@@ -0,0 +1,107 @@
+#include "checkpoint.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int write_all(int fd, const void *data, size_t size);
+static void sync_dir(const char *path);
+
+void cga_checkpoint_header_init(cga_checkpoint_header_t *header, uint64_t fingerprint, uint64_t order, uint64_t options, uint32_t worker, uint32_t nworkers) {
+    memset(header, 0, sizeof(cga_checkpoint_header_t));
+    memcpy(header->magic, CGA_CHECKPOINT_MAGIC, sizeof(CGA_CHECKPOINT_MAGIC));
+    header->version = CGA_CHECKPOINT_VERSION;
+    header->header_size = sizeof(cga_checkpoint_header_t);
+    header->fingerprint = fingerprint;
+    header->order = order;
+    header->options = options;
+    header->worker = worker;
+    header->nworkers = nworkers;
+}
+
+cga_status_t cga_checkpoint_save(const char *path, const cga_checkpoint_header_t *header, const uint32_t *done) {
+    int size = snprintf(NULL, 0, "%s.tmp", path);
+    char *tmp_path = malloc(size + 1);
+    if (tmp_path == NULL)
+        return NOMEM;
+    snprintf(tmp_path, size + 1, "%s.tmp", path);
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        free(tmp_path);
+        return NWPERM;
+    }
+    int ok = write_all(fd, header, sizeof(cga_checkpoint_header_t))
+        && write_all(fd, done, header->ndone * sizeof(uint32_t))
+        && fsync(fd) == 0;
+    ok = (close(fd) == 0) && ok;
+    ok = ok && rename(tmp_path, path) == 0;
+    if (ok)
+        sync_dir(path);  // makes the rename itself durable
+    else
+        remove(tmp_path);
+    free(tmp_path);
+    return ok ? SUCCESS : NWPERM;
+}
+
+cga_status_t cga_checkpoint_load(const char *path, cga_checkpoint_header_t *header, uint32_t **done) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return errno == ENOENT ? NFOUND : NRPERM;
+    if (fread(header, sizeof(cga_checkpoint_header_t), 1, fp) != 1
+        || memcmp(header->magic, CGA_CHECKPOINT_MAGIC, sizeof(CGA_CHECKPOINT_MAGIC)) != 0
+        || header->version != CGA_CHECKPOINT_VERSION || header->header_size != sizeof(cga_checkpoint_header_t)
+        || header->ndone > UINT32_MAX) {
+        fclose(fp);
+        return WRFORMAT;
+    }
+    *done = malloc((header->ndone ? header->ndone : 1) * sizeof(uint32_t));
+    if (*done == NULL) {
+        fclose(fp);
+        return NOMEM;
+    }
+    if (fread(*done, sizeof(uint32_t), header->ndone, fp) != header->ndone) {
+        free(*done);
+        *done = NULL;
+        fclose(fp);
+        return WRFORMAT;
+    }
+    fclose(fp);
+    return SUCCESS;
+}
+
+/**
+ * Writes size bytes of data, retrying the partial writes.
+ *
+ * Returns 1 if the operation completed without errors, 0 otherwise
+ */
+static int write_all(int fd, const void *data, size_t size) {
+    const char *p = data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        size -= n;
+    }
+    return 1;
+}
+
+/**
+ * Flushes to the disk the directory containing path, so the entries created or renamed there
+ * survive a crash. Errors are ignored: some file systems don't allow to sync a directory.
+ */
+static void sync_dir(const char *path) {
+    const char *slash = strrchr(path, '/');
+    char *dir = slash == NULL ? strdup(".") : strndup(path, slash == path ? 1 : (size_t)(slash - path));
+    if (dir == NULL)
+        return;
+    int fd = open(dir, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    free(dir);
+}
@@ -0,0 +1,335 @@
+#include "cone.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "graph.h"
+#include "hash.h"
+#include "visited.h"
+
+#define CONE_MAGIC "CGACONE"
+#define CONE_VERSION 1
+#define CONE_BLOCK_BITS 16
+#define CONE_ARRAY_MAX 4096             // above this size a bitmap is smaller than a sorted array
+#define CONE_BITMAP_WORDS (65536 / 16)  // uint16_t words of a bitmap container
+
+/**
+ * The containers of the cone of v are the ones in [first[v], first[v + 1]), sorted by key.
+ * The container c holds the vertex_ids whose upper bits are key[c]: card[c] lower halves sorted
+ * in pool[data[c]] if card[c] <= CONE_ARRAY_MAX, a bitmap of 65536 bits starting at pool[data[c]]
+ * otherwise (data[c] is a multiple of 4, so the bitmap can be read as uint64_t words).
+ */
+struct _cga_cones {
+    uint32_t vcount;
+    uint64_t fingerprint;
+    uint64_t *first;
+    uint32_t *size;
+    uint16_t *key;
+    uint32_t *card;
+    uint64_t *data;
+    uint16_t *pool;
+    uint64_t ncontainers;
+    uint64_t pool_len;
+    uint64_t containers_size;
+    uint64_t pool_size;
+};
+
+/**
+ * Header of the file written by cga_cones_save, followed by the arrays first, size, key, card,
+ * data and pool of the cones.
+ */
+typedef struct _cone_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t vcount;
+    uint64_t fingerprint;
+    uint64_t ncontainers;
+    uint64_t pool_len;
+} cone_header_t;
+
+static cga_cones_t *cones_alloc(uint32_t vcount);
+static int cones_reserve(cga_cones_t *cones, uint64_t ncontainers, uint64_t pool_len);
+static int cones_add(cga_cones_t *cones, uint32_t *members, uint32_t n);
+static uint64_t graph_fingerprint(const cga_graph_t *graph);
+static int cmp_vertex(const void *a, const void *b);
+
+cga_cones_t *cga_cones_init(const cga_graph_t *graph) {
+    uint32_t vcount = cga_graph_vcount(graph);
+    cga_cones_t *cones = cones_alloc(vcount);
+    if (cones == NULL)
+        return NULL;
+    cones->fingerprint = graph_fingerprint(graph);
+    cga_visited_t in_cone;
+    uint32_t *members = malloc((vcount ? vcount : 1) * sizeof(uint32_t));
+    if (members == NULL || cga_vs_init(&in_cone, vcount) != SUCCESS) {
+        free(members);
+        cga_cones_destroy(cones);
+        return NULL;
+    }
+    for (uint32_t v = 0; v < vcount; v++) {
+        // breadth first search over the provider-to-customer edges, members is also the queue
+        uint32_t n = 0;
+        cga_vs_clear(&in_cone);
+        cga_vs_insert(&in_cone, v);
+        members[n++] = v;
+        for (uint32_t head = 0; head < n; head++) {
+            uint32_t u = members[head];
+            for (uint32_t i = graph->offsets[u]; i < graph->offsets[u + 1]; i++) {
+                uint32_t w = CGA_ADJ_VERTEX(graph->adj[i]);
+                if (CGA_ADJ_REL(graph->adj[i]) != CGA_REL_P2C || cga_vs_contains(&in_cone, w)) continue;
+                cga_vs_insert(&in_cone, w);
+                members[n++] = w;
+            }
+        }
+        qsort(members, n, sizeof(uint32_t), cmp_vertex);
+        cones->first[v] = cones->ncontainers;
+        cones->size[v] = n;
+        if (!cones_add(cones, members, n)) {
+            cga_vs_destroy(&in_cone);
+            free(members);
+            cga_cones_destroy(cones);
+            return NULL;
+        }
+    }
+    cones->first[vcount] = cones->ncontainers;
+    cga_vs_destroy(&in_cone);
+    free(members);
+    return cones;
+}
+
+void cga_cones_destroy(cga_cones_t *cones) {
+    free(cones->first);
+    free(cones->size);
+    free(cones->key);
+    free(cones->card);
+    free(cones->data);
+    free(cones->pool);
+    free(cones);
+}
+
+int cga_cones_contains(const cga_cones_t *cones, uint32_t v, uint32_t w) {
+    uint16_t key = w >> CONE_BLOCK_BITS, low = w & 0xffff;
+    for (uint64_t c = cones->first[v]; c < cones->first[v + 1]; c++) {
+        if (cones->key[c] < key) continue;
+        if (cones->key[c] > key) return 0;
+        const uint16_t *data = &cones->pool[cones->data[c]];
+        if (cones->card[c] > CONE_ARRAY_MAX)
+            return (((const uint64_t *)data)[low >> 6] >> (low & 63)) & 1;
+        uint32_t lo = 0, hi = cones->card[c];
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (data[mid] == low)
+                return 1;
+            if (data[mid] < low)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return 0;
+    }
+    return 0;
+}
+
+uint32_t cga_cones_size(const cga_cones_t *cones, uint32_t v) {
+    return cones->size[v];
+}
+
+void cga_cones_members(const cga_cones_t *cones, uint32_t v, uint32_t *members) {
+    uint32_t n = 0;
+    for (uint64_t c = cones->first[v]; c < cones->first[v + 1]; c++) {
+        uint32_t base = (uint32_t)cones->key[c] << CONE_BLOCK_BITS;
+        const uint16_t *data = &cones->pool[cones->data[c]];
+        if (cones->card[c] <= CONE_ARRAY_MAX) {
+            for (uint32_t i = 0; i < cones->card[c]; i++)
+                members[n++] = base | data[i];
+            continue;
+        }
+        const uint64_t *bitmap = (const uint64_t *)data;
+        for (uint32_t i = 0; i < CONE_BITMAP_WORDS / 4; i++) {
+            for (uint64_t word = bitmap[i]; word != 0; word &= word - 1)
+                members[n++] = base | (i << 6) | (uint32_t)__builtin_ctzll(word);
+        }
+    }
+}
+
+cga_status_t cga_cones_save(const cga_cones_t *cones, const char *path) {
+    cone_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CONE_MAGIC, sizeof(CONE_MAGIC));
+    header.version = CONE_VERSION;
+    header.vcount = cones->vcount;
+    header.fingerprint = cones->fingerprint;
+    header.ncontainers = cones->ncontainers;
+    header.pool_len = cones->pool_len;
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL)
+        return NWPERM;
+    size_t n = cones->ncontainers;
+    int ok = fwrite(&header, sizeof(header), 1, fp) == 1
+        && fwrite(cones->first, sizeof(uint64_t), (size_t)cones->vcount + 1, fp) == (size_t)cones->vcount + 1
+        && fwrite(cones->size, sizeof(uint32_t), cones->vcount, fp) == cones->vcount
+        && fwrite(cones->key, sizeof(uint16_t), n, fp) == n
+        && fwrite(cones->card, sizeof(uint32_t), n, fp) == n
+        && fwrite(cones->data, sizeof(uint64_t), n, fp) == n
+        && fwrite(cones->pool, sizeof(uint16_t), cones->pool_len, fp) == cones->pool_len;
+    ok = (fclose(fp) == 0) && ok;
+    return ok ? SUCCESS : NWPERM;
+}
+
+cga_status_t cga_cones_load(cga_cones_t **cones, const cga_graph_t *graph, const char *path) {
+    cone_header_t header;
+    *cones = NULL;
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return NRPERM;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, CONE_MAGIC, sizeof(CONE_MAGIC)) != 0
+        || header.version != CONE_VERSION || header.vcount != cga_graph_vcount(graph)
+        || header.fingerprint != graph_fingerprint(graph)) {
+        fclose(fp);
+        return WRFORMAT;
+    }
+    cga_cones_t *res = cones_alloc(header.vcount);
+    if (res == NULL || !cones_reserve(res, header.ncontainers, header.pool_len)) {
+        if (res != NULL) cga_cones_destroy(res);
+        fclose(fp);
+        return NOMEM;
+    }
+    res->fingerprint = header.fingerprint;
+    res->ncontainers = header.ncontainers;
+    res->pool_len = header.pool_len;
+    size_t n = header.ncontainers;
+    int ok = fread(res->first, sizeof(uint64_t), (size_t)header.vcount + 1, fp) == (size_t)header.vcount + 1
+        && fread(res->size, sizeof(uint32_t), header.vcount, fp) == header.vcount
+        && fread(res->key, sizeof(uint16_t), n, fp) == n
+        && fread(res->card, sizeof(uint32_t), n, fp) == n
+        && fread(res->data, sizeof(uint64_t), n, fp) == n
+        && fread(res->pool, sizeof(uint16_t), header.pool_len, fp) == header.pool_len;
+    fclose(fp);
+    // the offsets must stay inside the arrays, so a corrupted file can't make the lookups overflow
+    for (uint32_t v = 0; ok && v < header.vcount; v++)
+        ok = res->first[v] <= res->first[v + 1];
+    ok = ok && res->first[0] == 0 && res->first[header.vcount] == n;
+    for (size_t c = 0; ok && c < n; c++) {
+        int bitmap = res->card[c] > CONE_ARRAY_MAX;
+        uint64_t len = bitmap ? CONE_BITMAP_WORDS : res->card[c];
+        ok = res->card[c] > 0 && res->card[c] <= 65536 && (!bitmap || res->data[c] % 4 == 0) && res->data[c] + len <= res->pool_len;
+    }
+    if (!ok) {
+        cga_cones_destroy(res);
+        return WRFORMAT;
+    }
+    *cones = res;
+    return SUCCESS;
+}
+
+/**
+ * Allocates an empty cones object for vcount vertices.
+ *
+ * Returns a pointer to the cones, NULL if there's not enough memory
+ */
+static cga_cones_t *cones_alloc(uint32_t vcount) {
+    cga_cones_t *cones = calloc(1, sizeof(cga_cones_t));
+    if (cones == NULL)
+        return NULL;
+    cones->vcount = vcount;
+    cones->first = calloc((size_t)vcount + 1, sizeof(uint64_t));
+    cones->size = calloc(vcount ? vcount : 1, sizeof(uint32_t));
+    if (cones->first == NULL || cones->size == NULL || !cones_reserve(cones, vcount, vcount)) {
+        cga_cones_destroy(cones);
+        return NULL;
+    }
+    return cones;
+}
+
+/**
+ * Grows the containers and the pool of the cones, if needed, to hold at least ncontainers
+ * containers and pool_len words.
+ *
+ * Returns 1 if the operation completed without errors, 0 if there's not enough memory
+ */
+static int cones_reserve(cga_cones_t *cones, uint64_t ncontainers, uint64_t pool_len) {
+    if (ncontainers > cones->containers_size || cones->key == NULL) {
+        uint64_t size = cones->containers_size ? cones->containers_size : 1024;
+        while (size < ncontainers) size *= 2;
+        uint16_t *key = realloc(cones->key, size * sizeof(uint16_t));
+        if (key != NULL) cones->key = key;
+        uint32_t *card = realloc(cones->card, size * sizeof(uint32_t));
+        if (card != NULL) cones->card = card;
+        uint64_t *data = realloc(cones->data, size * sizeof(uint64_t));
+        if (data != NULL) cones->data = data;
+        if (key == NULL || card == NULL || data == NULL)
+            return 0;
+        cones->containers_size = size;
+    }
+    if (pool_len > cones->pool_size || cones->pool == NULL) {
+        uint64_t size = cones->pool_size ? cones->pool_size : 4096;
+        while (size < pool_len) size *= 2;
+        uint16_t *pool = realloc(cones->pool, size * sizeof(uint16_t));
+        if (pool == NULL)
+            return 0;
+        cones->pool = pool;
+        cones->pool_size = size;
+    }
+    return 1;
+}
+
+/**
+ * Appends the containers of a cone, given as an array of sorted vertex_ids.
+ *
+ * Returns 1 if the operation completed without errors, 0 if there's not enough memory
+ */
+static int cones_add(cga_cones_t *cones, uint32_t *members, uint32_t n) {
+    uint32_t begin = 0;
+    while (begin < n) {
+        uint32_t key = members[begin] >> CONE_BLOCK_BITS, end = begin;
+        while (end < n && members[end] >> CONE_BLOCK_BITS == key) end++;
+        uint32_t card = end - begin;
+        uint64_t offset = cones->pool_len, len = card;
+        if (card > CONE_ARRAY_MAX) {
+            offset = (offset + 3) & ~(uint64_t)3;  // bitmaps are read as uint64_t words
+            len = CONE_BITMAP_WORDS;
+        }
+        if (!cones_reserve(cones, cones->ncontainers + 1, offset + len))
+            return 0;
+        uint16_t *data = &cones->pool[offset];
+        if (card > CONE_ARRAY_MAX) {
+            uint64_t *bitmap = (uint64_t *)data;
+            memset(bitmap, 0, CONE_BITMAP_WORDS * sizeof(uint16_t));
+            for (uint32_t i = begin; i < end; i++)
+                bitmap[(members[i] & 0xffff) >> 6] |= UINT64_C(1) << (members[i] & 63);
+        } else {
+            for (uint32_t i = begin; i < end; i++)
+                data[i - begin] = members[i] & 0xffff;
+        }
+        memset(&cones->pool[cones->pool_len], 0, (offset - cones->pool_len) * sizeof(uint16_t));  // padding
+        cones->key[cones->ncontainers] = key;
+        cones->card[cones->ncontainers] = card;
+        cones->data[cones->ncontainers] = offset;
+        cones->ncontainers++;
+        cones->pool_len = offset + len;
+        begin = end;
+    }
+    return 1;
+}
+
+/**
+ * Hash of the topology of the graph, used to recognize the graph a cones file belongs to.
+ */
+static uint64_t graph_fingerprint(const cga_graph_t *graph) {
+    uint64_t h = cga_hash_int(((uint64_t)graph->vcount << 32) | graph->ecount);
+    for (uint32_t v = 0; v <= graph->vcount; v++)
+        h = cga_hash_int(h ^ graph->offsets[v]);
+    for (uint32_t i = 0; i < graph->ecount; i++)
+        h = cga_hash_int(h ^ graph->adj[i]) + i;
+    for (uint32_t v = 0; v < graph->vcount; v++)
+        h = cga_hash_int(h ^ graph->labels[v]);
+    return h;
+}
+
+/**
+ * Comparison function used to sort the members of a cone
+ */
+static int cmp_vertex(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
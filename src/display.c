@@ -1,28 +1,37 @@
 #include <igraph/igraph.h>
 #include "as_relationship.h"
+#include "display.h"
+#include "graph.h"
 
-void cga_print_info(igraph_t *graph) {
-    printf("Vertices: %d\n", (int)igraph_vcount(graph));
-    printf("Edges: %d\n", (int)igraph_ecount(graph));
-    printf("Is directed? %s\n", igraph_is_directed(graph) ? "TRUE" : "FALSE");
+void cga_print_info(cga_graph_t *graph) {
+    printf("Vertices: %u\n", (unsigned int)cga_graph_vcount(graph));
+    printf("Edges: %u\n", (unsigned int)(graph->ecount / 2));
 }
 
-void cga_print_vector_label(igraph_t *graph, igraph_vector_int_t *v, FILE *ostream) {
+void cga_print_vector_label(cga_graph_t *graph, igraph_vector_int_t *v, FILE *ostream) {
     for (long i = 0; i < igraph_vector_int_size(v); i++) {
         if(i == (igraph_vector_int_size(v) -1))
-            fprintf(ostream,"%lu\n", (unsigned long) VAN(graph, "label", VECTOR(*v)[i]));
+            fprintf(ostream,"%lu\n", cga_graph_label(graph, VECTOR(*v)[i]));
         else
-            fprintf(ostream,"%lu ", (unsigned long) VAN(graph, "label", VECTOR(*v)[i]));
+            fprintf(ostream,"%lu ", cga_graph_label(graph, VECTOR(*v)[i]));
     }
 }
 
-void cga_print_degree_freedom_path(igraph_t *graph, igraph_integer_t vertex1_id, igraph_integer_t vertex2_id) {
+int cga_print_path_label(cga_graph_t *graph, const cga_path_view_t *path, void *ostream) {
+    for (long i = 0; i <= path->length; i++) {
+        fprintf((FILE *)ostream, "%lu ", cga_graph_label(graph, path->vertices[i]));
+    }
+    fprintf((FILE *)ostream, "- length %li, cost %d\n", path->length, path->cost);
+    return 0;
+}
+
+void cga_print_degree_freedom_path(cga_graph_t *graph, igraph_integer_t vertex1_id, igraph_integer_t vertex2_id) {
     unsigned int vfree = 0, nvfree = 0;
     float res = cga_degree_freedom_path(graph, vertex1_id, vertex2_id, &vfree, &nvfree);
     printf("Grado di libertá: %.2f, vfree: %u, nvfree: %u\n", res, vfree, nvfree);
 }
 
-void cga_print_result_label(igraph_t *graph, igraph_vector_int_t *res, FILE *ostream) {
+void cga_print_result_label(cga_graph_t *graph, igraph_vector_int_t *res, FILE *ostream) {
     igraph_vector_int_t v;
     igraph_vector_int_init(&v, 0);
     for(long i = 0; i < igraph_vector_int_size(res); i++) {
@@ -38,7 +47,7 @@ void cga_print_result_label(igraph_t *graph, igraph_vector_int_t *res, FILE *ost
     igraph_vector_int_destroy(&v);
 }
 
-void cga_print_result_label_vfree(igraph_t *graph, igraph_vector_int_t *res, FILE *ostream) {
+void cga_print_result_label_vfree(cga_graph_t *graph, igraph_vector_int_t *res, FILE *ostream) {
     igraph_vector_int_t v;
     igraph_vector_int_init(&v, 0);
     for(long i = 0; i < igraph_vector_int_size(res); i++) {
@@ -48,7 +57,7 @@ void cga_print_result_label_vfree(igraph_t *graph, igraph_vector_int_t *res, FIL
         }
         else { // path is complete, is valley free?
             for (long j = 0; j < igraph_vector_int_size(&v); j++) {
-                fprintf(ostream,"%lu ", (unsigned long) VAN(graph, "label", VECTOR(v)[j]));
+                fprintf(ostream,"%lu ", cga_graph_label(graph, VECTOR(v)[j]));
             }
             fprintf(ostream,"- %s\n", cga_is_valley_free(graph, &v) ? "OK" : "NOPE");
             igraph_vector_int_clear(&v);
@@ -57,16 +66,12 @@ void cga_print_result_label_vfree(igraph_t *graph, igraph_vector_int_t *res, FIL
     igraph_vector_int_destroy(&v);
 }
 
-void cga_print_adj(igraph_t *graph) {
-    igraph_lazy_adjlist_t adj;
-    igraph_lazy_adjlist_init(graph, &adj, IGRAPH_ALL, 1);
-    for(long i = 0; i < igraph_vcount(graph); i++) {
-        printf("%lu -", (unsigned long) VAN(graph, "label", i));
-        igraph_vector_t *v = igraph_lazy_adjlist_get(&adj, i);
-        for (long j = 0; j < igraph_vector_size(v); j++) {
-            printf(" %lu", (unsigned long) VAN(graph, "label", VECTOR(*v)[j]));
+void cga_print_adj(cga_graph_t *graph) {
+    for(uint32_t i = 0; i < cga_graph_vcount(graph); i++) {
+        printf("%lu -", cga_graph_label(graph, i));
+        for (uint32_t j = graph->offsets[i]; j < graph->offsets[i + 1]; j++) {
+            printf(" %lu", cga_graph_label(graph, CGA_ADJ_VERTEX(graph->adj[j])));
         }
         printf("\n");
     }
-    igraph_lazy_adjlist_destroy(&adj);
 }
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include "graph.h"
+#include <igraph/igraph.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "hash.h"
+
+static int cmp_adj(const void *a, const void *b);
+
+cga_status_t cga_graph_init(cga_graph_t *graph, uint32_t vcount, const cga_edge_t *edges, size_t nedges) {
+    memset(graph, 0, sizeof(cga_graph_t));
+    if (vcount > CGA_GRAPH_MAX_VERTICES || nedges > (UINT32_MAX / 2)) return WRFORMAT;
+    graph->vcount = vcount;
+    graph->offsets = calloc((size_t)vcount + 1, sizeof(uint32_t));
+    graph->labels = calloc(vcount ? vcount : 1, sizeof(unsigned long));
+    graph->adj = malloc((nedges ? 2 * nedges : 1) * sizeof(uint32_t));
+    if (graph->offsets == NULL || graph->labels == NULL || graph->adj == NULL) {
+        cga_graph_destroy(graph);
+        return NOMEM;
+    }
+
+    // count the neighbors of each vertex, then turn the counters into offsets
+    for (size_t i = 0; i < nedges; i++) {
+        if (edges[i].from >= vcount || edges[i].to >= vcount) {
+            cga_graph_destroy(graph);
+            return WRFORMAT;
+        }
+        graph->offsets[edges[i].from + 1]++;
+        graph->offsets[edges[i].to + 1]++;
+    }
+    for (uint32_t v = 0; v < vcount; v++)
+        graph->offsets[v + 1] += graph->offsets[v];
+
+    uint32_t *fill = malloc(((size_t)vcount + 1) * sizeof(uint32_t));
+    if (fill == NULL) {
+        cga_graph_destroy(graph);
+        return NOMEM;
+    }
+    memcpy(fill, graph->offsets, ((size_t)vcount + 1) * sizeof(uint32_t));
+    for (size_t i = 0; i < nedges; i++) {
+        graph->adj[fill[edges[i].from]++] = CGA_ADJ_PACK(edges[i].to, edges[i].rel);
+        graph->adj[fill[edges[i].to]++] = CGA_ADJ_PACK(edges[i].from, -edges[i].rel);
+    }
+    free(fill);
+
+    // sort each adjacency list and drop self loops and duplicated neighbors
+    uint32_t write = 0;
+    for (uint32_t v = 0; v < vcount; v++) {
+        uint32_t begin = graph->offsets[v], end = graph->offsets[v + 1];
+        cga_graph_sort_adj(&graph->adj[begin], end - begin);
+        graph->offsets[v] = write;
+        for (uint32_t i = begin; i < end; i++) {
+            uint32_t w = CGA_ADJ_VERTEX(graph->adj[i]);
+            if (w == v) continue;
+            if (write > graph->offsets[v] && CGA_ADJ_VERTEX(graph->adj[write - 1]) == w) continue;
+            graph->adj[write++] = graph->adj[i];
+        }
+    }
+    graph->offsets[vcount] = write;
+    graph->ecount = write;
+    return SUCCESS;
+}
+
+void cga_graph_sort_adj(uint32_t *adj, size_t n) {
+    qsort(adj, n, sizeof(uint32_t), cmp_adj);
+}
+
+void cga_graph_destroy(cga_graph_t *graph) {
+    if (graph->mapping != NULL) {
+        munmap(graph->mapping, graph->mapping_size);
+    } else {
+        free(graph->offsets);
+        free(graph->adj);
+        free(graph->labels);
+        free(graph->index);
+    }
+    memset(graph, 0, sizeof(cga_graph_t));
+}
+
+int cga_graph_relation(const cga_graph_t *graph, uint32_t from, uint32_t to) {
+    uint32_t lo = graph->offsets[from], hi = graph->offsets[from + 1];
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint32_t w = CGA_ADJ_VERTEX(graph->adj[mid]);
+        if (w == to)
+            return CGA_ADJ_REL(graph->adj[mid]);
+        if (w < to)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return CGA_REL_C2P;  // not adjacent, treated as customer to provider edge
+}
+
+igraph_integer_t cga_graph_find(const cga_graph_t *graph, unsigned long asn) {
+    if (graph->index == NULL) {
+        for (uint32_t v = 0; v < graph->vcount; v++) {
+            if (graph->labels[v] == asn) return v;
+        }
+        return -1;
+    }
+    uint32_t lo = 0, hi = graph->vcount;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (graph->index[mid].asn == asn)
+            return graph->index[mid].id;
+        if (graph->index[mid].asn < asn)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return -1;
+}
+
+uint64_t cga_graph_fingerprint(const cga_graph_t *graph) {
+    // a commutative sum of the hashes of the adjacency entries, so the order doesn't matter
+    uint64_t sum = 0;
+    for (uint32_t v = 0; v < graph->vcount; v++) {
+        uint64_t from = cga_hash_int(graph->labels[v]);
+        for (uint32_t i = graph->offsets[v]; i < graph->offsets[v + 1]; i++) {
+            uint64_t to = (uint64_t)graph->labels[CGA_ADJ_VERTEX(graph->adj[i])];
+            sum += cga_hash_int(from ^ ((to << 2) | (uint64_t)(CGA_ADJ_REL(graph->adj[i]) + 1)));
+        }
+    }
+    return cga_hash_int(sum ^ cga_hash_int(((uint64_t)graph->vcount << 32) | graph->ecount));
+}
+
+cga_status_t cga_graph_to_igraph(const cga_graph_t *graph, igraph_t *out) {
+    igraph_vector_t edges, edges_attr;
+    if (igraph_vector_init(&edges, 0) != 0) return NOMEM;
+    if (igraph_vector_init(&edges_attr, 0) != 0) {
+        igraph_vector_destroy(&edges);
+        return NOMEM;
+    }
+    // p2c edges are stored once from the provider side, p2p edges once from each side
+    for (uint32_t v = 0; v < graph->vcount; v++) {
+        for (uint32_t i = graph->offsets[v]; i < graph->offsets[v + 1]; i++) {
+            int rel = CGA_ADJ_REL(graph->adj[i]);
+            if (rel == CGA_REL_C2P) continue;
+            igraph_vector_push_back(&edges, v);
+            igraph_vector_push_back(&edges, CGA_ADJ_VERTEX(graph->adj[i]));
+            igraph_vector_push_back(&edges_attr, rel);
+        }
+    }
+    igraph_empty(out, 0, IGRAPH_DIRECTED);
+    igraph_add_vertices(out, graph->vcount, 0);
+    igraph_add_edges(out, &edges, 0);
+    for (long i = 0; i < igraph_vector_size(&edges_attr); i++) {
+        SETEAN(out, "type", i, VECTOR(edges_attr)[i]);
+    }
+    for (uint32_t v = 0; v < graph->vcount; v++) {
+        SETVAN(out, "label", v, graph->labels[v]);
+    }
+    igraph_vector_destroy(&edges);
+    igraph_vector_destroy(&edges_attr);
+    return SUCCESS;
+}
+
+/**
+ * Comparison function used to sort the packed adjacency lists
+ */
+static int cmp_adj(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
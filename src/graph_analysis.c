@@ -11,8 +11,7 @@ int main(int argc, char **argv) {
 
     cga_hashtable_t *ht = cga_ht_init(3000);
 
-    igraph_t igraph;
-    igraph_i_set_attribute_table(&igraph_cattribute_table);
+    cga_graph_t graph;
 
     FILE *fp = fopen("hashtable.txt", "r");
     if (fp != NULL) {
@@ -26,7 +25,7 @@ int main(int argc, char **argv) {
         perror("fopen caida file");
         exit(EXIT_FAILURE);
     }
-    cga_load_snapshot(&igraph, ht, fp);
+    cga_load_snapshot(&graph, ht, fp);
     fclose(fp);
 
     fp = fopen("hashtable.txt", "w+");
@@ -35,10 +34,13 @@ int main(int argc, char **argv) {
     igraph_vector_int_t res;
     igraph_vector_int_init(&res, 0);
 
-    cga_graph_analysis(&igraph, 1, "./output/test/test");
+    if (cga_graph_analysis(&graph, 1, "./output/test/test") != SUCCESS) {
+        fprintf(stderr, "%s", "Analysis failed: can't write ./output/test/test_0.csv or out of memory\n");
+        exit(EXIT_FAILURE);
+    }
     printf("Finish!\n");
     igraph_vector_int_destroy(&res);
-    igraph_destroy(&igraph);
+    cga_graph_destroy(&graph);
     cga_ht_destroy(ht);
 
     return 0;
@@ -17,4 +17,18 @@ unsigned long cga_hash(unsigned long key) {
         hash = hash * FNV_PRIME_64;
     }
     return hash;
+}
+
+/**
+ * Each xor-shift spreads the high bits into the low ones, each multiplication the low bits
+ * into the high ones.
+ */
+unsigned long cga_hash_int(unsigned long key) {
+    unsigned long long hash = key;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return (unsigned long)hash;
 }
\ No newline at end of file
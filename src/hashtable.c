@@ -3,126 +3,118 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
 #include "hashtable.h"
 #include "hash.h"
 
 
 
-typedef struct _cga_ht_node {
+#define HT_MIN_CAPACITY 16
+#define HT_MAX_LOAD_NUM 7  // the table grows when it's more than 7/8 full
+#define HT_MAX_LOAD_DEN 8
+
+/**
+ * Slot of the open addressing table. dist is the distance of the slot from the home slot
+ * of the key plus one, 0 means that the slot is empty.
+ */
+typedef struct _cga_ht_slot {
     unsigned long key;
     igraph_integer_t value;
-    struct _cga_ht_node *next;
-} cga_ht_node_t;
-
+    uint32_t dist;
+} cga_ht_slot_t;
+
+/**
+ * Robin Hood hashtable with linear probing: a key being inserted takes the slot of any key that
+ * is closer to its own home slot, so probe sequences stay short even at high load factors and a
+ * search can stop as soon as it meets a key closer to its home than the searched one would be.
+ * The capacity is always a power of two.
+ */
 struct _cga_hashtable {
-    size_t size;
+    size_t capacity;
     size_t nelem;
-    cga_ht_node_t **table;
+    cga_ht_slot_t *table;
 };
 
-static cga_ht_node_t* cga_ht_node_constructor(unsigned long key, igraph_integer_t value, cga_ht_node_t *next);
-static void cga_ht_node_destructor(cga_ht_node_t *node);
-
-static cga_ht_node_t* cga_ht_node_constructor(unsigned long key, igraph_integer_t value, cga_ht_node_t *next) {
-    cga_ht_node_t *htn = NULL;
-    if((htn = (cga_ht_node_t*)malloc(sizeof(cga_ht_node_t))) == NULL)
-        return NULL;
-    htn->key = key;
-    htn->value = value;
-    htn->next = next;
-    return htn;
-}
-
-static void cga_ht_node_destructor(cga_ht_node_t *node) {
-    free(node);
-}
+static cga_status_t cga_ht_resize(cga_hashtable_t *ht, size_t capacity);
+static void cga_ht_place(cga_hashtable_t *ht, unsigned long key, igraph_integer_t value);
+static cga_ht_slot_t* cga_ht_find(cga_hashtable_t *ht, unsigned long key);
+static size_t cga_ht_capacity_for(size_t nelem);
 
 cga_hashtable_t* cga_ht_init(size_t size) {
     if(size == 0) return NULL;
     cga_hashtable_t *ht = (cga_hashtable_t*)malloc(sizeof(cga_hashtable_t));
     if(ht == NULL)
         return NULL;
-    ht->size = size;
+    ht->capacity = cga_ht_capacity_for(size);
     ht->nelem = 0;
-    if((ht->table = (cga_ht_node_t**)malloc(size * sizeof(cga_ht_node_t*))) == NULL)
+    if((ht->table = (cga_ht_slot_t*)calloc(ht->capacity, sizeof(cga_ht_slot_t))) == NULL) {
+        free(ht);
         return NULL;
-    for(size_t i = 0; i < size; i++)
-        ht->table[i] = NULL;
+    }
     return ht;
 }
 
 void cga_ht_destroy(cga_hashtable_t *ht) {
-    cga_ht_clear(ht);
     free(ht->table);
     free(ht);
 }
 
 void cga_ht_clear(cga_hashtable_t *ht) {
-    for(size_t i = 0; i < ht->size; i++) {
-        while(ht->table[i] != NULL) {
-            cga_ht_node_t *temp = ht->table[i];
-            ht->table[i] = temp->next;
-            cga_ht_node_destructor(temp);
-        }
-    }
+    memset(ht->table, 0, ht->capacity * sizeof(cga_ht_slot_t));
     ht->nelem = 0;
 }
 
+cga_status_t cga_ht_reserve(cga_hashtable_t *ht, size_t nelem) {
+    size_t capacity = cga_ht_capacity_for(nelem);
+    if(capacity <= ht->capacity) return SUCCESS;
+    return cga_ht_resize(ht, capacity);
+}
+
 cga_status_t cga_ht_insert(cga_hashtable_t *ht, unsigned long key, igraph_integer_t value) {
-    if(cga_ht_contains(ht, key)) return DPLKTKEY;
-    size_t index = cga_hash(key) % ht->size;
-    cga_ht_node_t *node = cga_ht_node_constructor(key,value, ht->table[index]);
-    if(node == NULL )
-        return NOMEM;
-    ht->table[index] = node;
+    if(cga_ht_find(ht, key) != NULL) return DPLKTKEY;
+    if((ht->nelem + 1) * HT_MAX_LOAD_DEN > ht->capacity * HT_MAX_LOAD_NUM) {
+        if(cga_ht_resize(ht, ht->capacity * 2) != SUCCESS)
+            return NOMEM;
+    }
+    cga_ht_place(ht, key, value);
     ht->nelem = ht->nelem + 1;
     return SUCCESS;
 }
 
 igraph_integer_t* cga_ht_search(cga_hashtable_t *ht, unsigned long key) {
-    size_t index = cga_hash(key) % ht->size;
-    cga_ht_node_t *node = ht->table[index];
-    while(node != NULL) {
-        if(node->key == key)
-            return &(node->value);
-        node = node->next;
-    }
-    return NULL;
+    cga_ht_slot_t *slot = cga_ht_find(ht, key);
+    return slot != NULL ? &(slot->value) : NULL;
 }
 
 int cga_ht_contains(cga_hashtable_t *ht, unsigned long key) {
-    size_t index = cga_hash(key) % ht->size;
-    cga_ht_node_t *node = ht->table[index];
-    while(node != NULL) {
-        if(node->key == key)
-            return 1;
-        else node = node->next;
-    }
-    return 0;
+    return cga_ht_find(ht, key) != NULL;
 }
 
 cga_status_t cga_ht_delete(cga_hashtable_t *ht, unsigned long key) {
-    size_t index = cga_hash(key) % ht->size;
-    cga_ht_node_t *current = ht->table[index];
-    cga_ht_node_t *prev = NULL;
-    while(current != NULL) {
-        if(current->key != key) {
-            prev = current;
-            current = current->next;
-        }
-        else {
-            if(prev == NULL) {
-                ht->table[index] = current->next;
-            }
-            else {
-                prev->next = current->next;
-            }
-            cga_ht_node_destructor(current);
-            ht->nelem = ht->nelem - 1;
-            return SUCCESS;
-        }
+    cga_ht_slot_t *slot = cga_ht_find(ht, key);
+    if(slot == NULL)
+        return NFOUND;
+    // backward shift: move back the following keys of the cluster that aren't in their home slot
+    size_t mask = ht->capacity - 1;
+    size_t index = slot - ht->table;
+    size_t next = (index + 1) & mask;
+    while(ht->table[next].dist > 1) {
+        ht->table[index] = ht->table[next];
+        ht->table[index].dist--;
+        index = next;
+        next = (next + 1) & mask;
+    }
+    ht->table[index].dist = 0;
+    ht->nelem = ht->nelem - 1;
+    return SUCCESS;
+}
+
+void cga_ht_foreach(cga_hashtable_t *ht, void (*visitor)(unsigned long key, igraph_integer_t *value, void *arg), void *arg) {
+    for(size_t i = 0; i < ht->capacity; i++) {
+        if(ht->table[i].dist != 0)
+            visitor(ht->table[i].key, &(ht->table[i].value), arg);
     }
-    return NFOUND;
 }
 
 cga_status_t cga_ht_save_to_file(cga_hashtable_t *ht, FILE *outstream) {
@@ -130,14 +122,9 @@ cga_status_t cga_ht_save_to_file(cga_hashtable_t *ht, FILE *outstream) {
         fprintf(stderr,"cga_ht_save_to_file permission denied. Have you opened the file in read mode?\n");
         return NWPERM;
     } 
-    for(size_t i = 0; i < ht->size; i++) {
-        if(ht->table[i] != NULL) {
-            cga_ht_node_t *temp = ht->table[i];
-            while(temp != NULL) {
-                fprintf(outstream, "%lu %d\n", temp->key, temp->value);
-                temp = temp->next;
-            }
-        }
+    for(size_t i = 0; i < ht->capacity; i++) {
+        if(ht->table[i].dist != 0)
+            fprintf(outstream, "%lu %d\n", ht->table[i].key, ht->table[i].value);
     }
     return SUCCESS;
 }
@@ -170,5 +157,67 @@ size_t cga_ht_nelems(cga_hashtable_t *ht) {
     return ht->nelem;
 }
 
+/**
+ * Moves all the keys in a new table of the given capacity (a power of two).
+ * 
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory.
+ */
+static cga_status_t cga_ht_resize(cga_hashtable_t *ht, size_t capacity) {
+    cga_ht_slot_t *old_table = ht->table;
+    size_t old_capacity = ht->capacity;
+    cga_ht_slot_t *table = (cga_ht_slot_t*)calloc(capacity, sizeof(cga_ht_slot_t));
+    if(table == NULL)
+        return NOMEM;
+    ht->table = table;
+    ht->capacity = capacity;
+    for(size_t i = 0; i < old_capacity; i++) {
+        if(old_table[i].dist != 0)
+            cga_ht_place(ht, old_table[i].key, old_table[i].value);
+    }
+    free(old_table);
+    return SUCCESS;
+}
+
+/**
+ * Stores the association <key, value> in the table, which must have at least a free slot and
+ * must not contain key.
+ */
+static void cga_ht_place(cga_hashtable_t *ht, unsigned long key, igraph_integer_t value) {
+    size_t mask = ht->capacity - 1;
+    size_t index = cga_hash_int(key) & mask;
+    cga_ht_slot_t entry = {key, value, 1};
+    while(ht->table[index].dist != 0) {
+        if(ht->table[index].dist < entry.dist) {  // the resident key is richer, take its slot
+            cga_ht_slot_t temp = ht->table[index];
+            ht->table[index] = entry;
+            entry = temp;
+        }
+        entry.dist++;
+        index = (index + 1) & mask;
+    }
+    ht->table[index] = entry;
+}
 
+/**
+ * Returns the slot that contains key, NULL if the key is not in the table.
+ */
+static cga_ht_slot_t* cga_ht_find(cga_hashtable_t *ht, unsigned long key) {
+    size_t mask = ht->capacity - 1;
+    size_t index = cga_hash_int(key) & mask;
+    for(uint32_t dist = 1; ht->table[index].dist >= dist; dist++) {
+        if(ht->table[index].key == key)
+            return &(ht->table[index]);
+        index = (index + 1) & mask;
+    }
+    return NULL;
+}
 
+/**
+ * Returns the smallest power of two capacity that can hold nelem keys without growing.
+ */
+static size_t cga_ht_capacity_for(size_t nelem) {
+    size_t capacity = HT_MIN_CAPACITY;
+    while(capacity * HT_MAX_LOAD_NUM < nelem * HT_MAX_LOAD_DEN)
+        capacity *= 2;
+    return capacity;
+}
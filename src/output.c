@@ -0,0 +1,150 @@
+#include "output.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "writer.h"
+
+#define CACHE_LINE 64
+#define OUTPUT_IDLE_NS 50000  // pause of the writer thread when all the rings are empty
+#define OUTPUT_RELEASE 256    // records formatted before giving their slots back to the producer
+
+/**
+ * Single-producer single-consumer ring of records. head is written only by the writer thread and
+ * tail only by the producer, each one on its own cache line; the producer keeps a copy of head
+ * and reads the real one only when the copy says that the ring is full.
+ * The slots in [head, tail) (modulo the capacity) hold the records still to be written.
+ */
+typedef struct _output_ring {
+    uint64_t head;
+    char pad_head[CACHE_LINE - sizeof(uint64_t)];
+    uint64_t tail;
+    uint64_t cached_head;
+    char pad_tail[CACHE_LINE - 2 * sizeof(uint64_t)];
+    char *slots;
+} output_ring_t;
+
+struct _cga_output {
+    pthread_t t_id;
+    cga_writer_t writer;
+    output_ring_t *rings;
+    unsigned int nrings;
+    size_t record_size;
+    uint64_t mask;  // capacity - 1
+    cga_record_format_t format;
+    void *arg;
+    int closing;
+};
+
+static void *output_job(void *attr);
+static size_t output_drain(cga_output_t *output, output_ring_t *ring);
+
+cga_status_t cga_output_open(cga_output_t **res, const char *path, const void *header, size_t header_size, unsigned int nproducers, size_t record_size, size_t capacity, cga_record_format_t format, void *arg) {
+    cga_output_t *output = calloc(1, sizeof(cga_output_t));
+    if (output == NULL)
+        return NOMEM;
+    size_t cap = 1;
+    while (cap < (capacity ? capacity : CGA_OUTPUT_CAPACITY))
+        cap <<= 1;
+    output->nrings = nproducers;
+    output->record_size = record_size;
+    output->mask = cap - 1;
+    output->format = format;
+    output->arg = arg;
+    if (posix_memalign((void **)&output->rings, CACHE_LINE, (nproducers ? nproducers : 1) * sizeof(output_ring_t)) != 0) {
+        free(output);
+        return NOMEM;
+    }
+    memset(output->rings, 0, (nproducers ? nproducers : 1) * sizeof(output_ring_t));
+    for (unsigned int i = 0; i < nproducers; i++) {
+        output->rings[i].slots = malloc(cap * record_size);
+        if (output->rings[i].slots == NULL) {
+            for (unsigned int k = 0; k < i; k++) free(output->rings[k].slots);
+            free(output->rings);
+            free(output);
+            return NOMEM;
+        }
+    }
+    cga_status_t status = cga_writer_open(&output->writer, path);
+    if (status != SUCCESS) {
+        for (unsigned int i = 0; i < nproducers; i++) free(output->rings[i].slots);
+        free(output->rings);
+        free(output);
+        return status;
+    }
+    if (header != NULL)
+        cga_writer_write(&output->writer, header, header_size);
+    if (pthread_create(&output->t_id, NULL, output_job, output) != 0) {
+        cga_writer_close(&output->writer);
+        for (unsigned int i = 0; i < nproducers; i++) free(output->rings[i].slots);
+        free(output->rings);
+        free(output);
+        return NOMEM;
+    }
+    *res = output;
+    return SUCCESS;
+}
+
+void cga_output_push(cga_output_t *output, unsigned int producer, const void *record) {
+    output_ring_t *ring = &output->rings[producer];
+    uint64_t tail = ring->tail;  // only this thread writes it
+    while (tail - ring->cached_head > output->mask) {  // full according to the copy of head
+        ring->cached_head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (tail - ring->cached_head > output->mask)
+            sched_yield();  // really full, let the writer thread run
+    }
+    memcpy(ring->slots + (tail & output->mask) * output->record_size, record, output->record_size);
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);  // publishes the record
+}
+
+cga_status_t cga_output_close(cga_output_t *output) {
+    __atomic_store_n(&output->closing, 1, __ATOMIC_RELEASE);
+    pthread_join(output->t_id, NULL);
+    cga_status_t status = cga_writer_close(&output->writer);
+    for (unsigned int i = 0; i < output->nrings; i++)
+        free(output->rings[i].slots);
+    free(output->rings);
+    free(output);
+    return status;
+}
+
+/**
+ * Writer thread: drains the rings round robin until the output is closed and all of them are
+ * empty, pausing for OUTPUT_IDLE_NS when there's nothing to write.
+ */
+static void *output_job(void *attr) {
+    cga_output_t *output = (cga_output_t *)attr;
+    struct timespec idle = {0, OUTPUT_IDLE_NS};
+    for (;;) {
+        // read closing before draining: records pushed before the close are seen by this pass
+        int closing = __atomic_load_n(&output->closing, __ATOMIC_ACQUIRE);
+        size_t written = 0;
+        for (unsigned int i = 0; i < output->nrings; i++)
+            written += output_drain(output, &output->rings[i]);
+        if (written == 0) {
+            if (closing)
+                break;
+            nanosleep(&idle, NULL);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Formats all the records of a ring published so far and frees their slots.
+ *
+ * Returns the number of records written
+ */
+static size_t output_drain(cga_output_t *output, output_ring_t *ring) {
+    uint64_t head = ring->head;  // only this thread writes it
+    uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    for (uint64_t i = head; i < tail; i++) {
+        output->format(&output->writer, ring->slots + (i & output->mask) * output->record_size, output->arg);
+        if ((i + 1 - head) % OUTPUT_RELEASE == 0)  // a producer waiting for room can go on
+            __atomic_store_n(&ring->head, i + 1, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&ring->head, tail, __ATOMIC_RELEASE);
+    return tail - head;
+}
@@ -0,0 +1,146 @@
+#include "pairs.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "writer.h"
+
+_Static_assert(sizeof(cga_pair_record_t) == 24, "the records are stored as they are in memory");
+
+static int clamp(int64_t value, int64_t min, int64_t max, uint8_t *flags);
+
+void cga_pairs_header_init(cga_pairs_header_t *header, const cga_graph_t *graph, uint32_t flags) {
+    memset(header, 0, sizeof(cga_pairs_header_t));
+    memcpy(header->magic, CGA_PAIRS_MAGIC, sizeof(CGA_PAIRS_MAGIC));
+    header->version = CGA_PAIRS_VERSION;
+    header->header_size = sizeof(cga_pairs_header_t);
+    header->record_size = sizeof(cga_pair_record_t);
+    header->flags = flags;
+    header->fingerprint = cga_graph_fingerprint(graph);
+    header->vcount = graph->vcount;
+    header->ecount = graph->ecount;
+}
+
+void cga_pair_record_init(cga_pair_record_t *record, const cga_graph_t *graph, uint32_t from, uint32_t to, const cga_pair_stats_t *stats, int truncated) {
+    memset(record, 0, sizeof(cga_pair_record_t));
+    record->from = (uint32_t)cga_graph_label(graph, from);
+    record->to = (uint32_t)cga_graph_label(graph, to);
+    if (truncated > 0) record->flags |= CGA_PAIR_TRUNCATED;
+    if (stats->count == 0) {
+        record->flags |= CGA_PAIR_EMPTY;
+        return;
+    }
+    // the same expressions print_pair_row prints, so the CSV written from the record is the same
+    record->avg_length = stats->length_sum / (float)stats->count;
+    record->avg_cost = stats->cost_sum / (float)stats->count;
+    record->length_min = clamp(stats->length_min, 0, UINT8_MAX, &record->flags);
+    record->length_max = clamp(stats->length_max, 0, UINT8_MAX, &record->flags);
+    record->cost_min = clamp(stats->cost_min, INT16_MIN, INT16_MAX, &record->flags);
+    record->cost_max = clamp(stats->cost_max, INT16_MIN, INT16_MAX, &record->flags);
+}
+
+void cga_pair_record_csv(cga_writer_t *out, const cga_pair_record_t *record, int reversed, int limited) {
+    cga_writer_uint(out, reversed ? record->to : record->from);
+    cga_writer_putc(out, ',');
+    cga_writer_uint(out, reversed ? record->from : record->to);
+    if (record->flags & CGA_PAIR_EMPTY) {
+        cga_writer_write(out, ",,,,,,", 6);
+    } else {
+        // a zero average stays positive when negated, as the sum it comes from
+        float avg_cost = (reversed && record->avg_cost != 0) ? -record->avg_cost : record->avg_cost;
+        cga_writer_putc(out, ',');
+        cga_writer_fixed(out, record->avg_length, 3);
+        cga_writer_putc(out, ',');
+        cga_writer_int(out, record->length_min);
+        cga_writer_putc(out, ',');
+        cga_writer_int(out, record->length_max);
+        cga_writer_putc(out, ',');
+        cga_writer_fixed(out, avg_cost, 3);
+        cga_writer_putc(out, ',');
+        cga_writer_int(out, reversed ? -record->cost_max : record->cost_min);
+        cga_writer_putc(out, ',');
+        cga_writer_int(out, reversed ? -record->cost_min : record->cost_max);
+    }
+    if (limited) {
+        cga_writer_putc(out, ',');
+        cga_writer_int(out, (record->flags & CGA_PAIR_TRUNCATED) ? 1 : 0);
+    }
+    cga_writer_putc(out, '\n');
+}
+
+cga_status_t cga_pairs_open(cga_pairs_t *pairs, const char *path) {
+    memset(pairs, 0, sizeof(cga_pairs_t));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NRPERM;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(cga_pairs_header_t)) {
+        close(fd);
+        return WRFORMAT;
+    }
+    char *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  // the mapping keeps the file open
+    if (data == MAP_FAILED)
+        return NRPERM;
+    const cga_pairs_header_t *header = (const cga_pairs_header_t *)data;
+    if (memcmp(header->magic, CGA_PAIRS_MAGIC, sizeof(CGA_PAIRS_MAGIC)) != 0 || header->version != CGA_PAIRS_VERSION
+        || header->header_size != sizeof(cga_pairs_header_t) || header->record_size != sizeof(cga_pair_record_t)) {
+        munmap(data, st.st_size);
+        return WRFORMAT;
+    }
+    pairs->header = header;
+    pairs->records = (const cga_pair_record_t *)(data + header->header_size);
+    pairs->count = (st.st_size - header->header_size) / header->record_size;
+    pairs->mapping = data;
+    pairs->mapping_size = st.st_size;
+    madvise(data, st.st_size, MADV_SEQUENTIAL);  // the records are usually scanned in order
+    return SUCCESS;
+}
+
+int cga_pairs_match(const cga_pairs_t *pairs, const cga_graph_t *graph) {
+    return pairs->header->fingerprint == cga_graph_fingerprint(graph)
+        && pairs->header->vcount == graph->vcount && pairs->header->ecount == graph->ecount;
+}
+
+void cga_pairs_close(cga_pairs_t *pairs) {
+    if (pairs->mapping != NULL)
+        munmap(pairs->mapping, pairs->mapping_size);
+    memset(pairs, 0, sizeof(cga_pairs_t));
+}
+
+cga_status_t cga_pairs_to_csv(const char *path, const char *csv_path) {
+    cga_pairs_t pairs;
+    cga_status_t status = cga_pairs_open(&pairs, path);
+    if (status != SUCCESS)
+        return status;
+    cga_writer_t out;
+    status = cga_writer_open(&out, csv_path);
+    if (status != SUCCESS) {
+        cga_pairs_close(&pairs);
+        return status;
+    }
+    int limited = (pairs.header->flags & CGA_PAIRS_LIMITED) != 0;
+    int symmetric = (pairs.header->flags & CGA_PAIRS_SYMMETRIC) != 0;
+    cga_writer_puts(&out, limited ? CGA_PAIRS_CSV_HEADER_LIMITED : CGA_PAIRS_CSV_HEADER);
+    for (size_t k = 0; k < pairs.count; k++) {
+        cga_pair_record_csv(&out, &pairs.records[k], 0, limited);
+        if (symmetric) cga_pair_record_csv(&out, &pairs.records[k], 1, limited);
+    }
+    cga_pairs_close(&pairs);
+    return cga_writer_close(&out);
+}
+
+/**
+ * Clamps value to [min, max], setting CGA_PAIR_SATURATED in flags if it is out of range.
+ *
+ * Returns the clamped value
+ */
+static int clamp(int64_t value, int64_t min, int64_t max, uint8_t *flags) {
+    if (value >= min && value <= max)
+        return (int)value;
+    *flags |= CGA_PAIR_SATURATED;
+    return (int)(value < min ? min : max);
+}
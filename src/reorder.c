@@ -0,0 +1,236 @@
+#include "reorder.h"
+#include <igraph/igraph.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "cone.h"
+#include "graph.h"
+#include "hashtable.h"
+#include "stats.h"
+
+/**
+ * Vertex with the key it is sorted by.
+ */
+typedef struct _order_key {
+    uint64_t key;
+    uint32_t id;
+} order_key_t;
+
+/**
+ * Permutation applied by cga_graph_permute to the vertex_ids of the hashtable.
+ */
+typedef struct _perm_map {
+    const uint32_t *perm;
+    uint32_t vcount;
+} perm_map_t;
+
+static order_key_t *sorted_vertices(const cga_graph_t *graph, const cga_cones_t *cones, int descending);
+static uint32_t bfs_order(const cga_graph_t *graph, uint32_t source, uint8_t *visited, uint32_t *seq, uint32_t len, order_key_t *buf, int by_degree);
+static int cmp_key_desc(const void *a, const void *b);
+static int cmp_key_asc(const void *a, const void *b);
+static void remap_vertex(unsigned long key, igraph_integer_t *value, void *arg);
+
+cga_status_t cga_graph_order(const cga_graph_t *graph, cga_order_t order, uint32_t *perm) {
+    uint32_t vcount = cga_graph_vcount(graph);
+    cga_cones_t *cones = NULL;
+    if (order == CGA_ORDER_CONE) {
+        cones = cga_cones_init(graph);
+        if (cones == NULL)
+            return NOMEM;
+    }
+    // BFS starts from the largest vertices, RCM from the smallest ones
+    order_key_t *keys = sorted_vertices(graph, cones, order != CGA_ORDER_RCM);
+    if (cones != NULL)
+        cga_cones_destroy(cones);
+    if (keys == NULL)
+        return NOMEM;
+    if (order == CGA_ORDER_DEGREE || order == CGA_ORDER_CONE) {
+        for (uint32_t k = 0; k < vcount; k++)
+            perm[keys[k].id] = k;
+        free(keys);
+        return SUCCESS;
+    }
+
+    uint32_t *seq = malloc((vcount ? vcount : 1) * sizeof(uint32_t));  // the vertices in the new order
+    uint8_t *visited = calloc(vcount ? vcount : 1, sizeof(uint8_t));
+    uint32_t max_degree = 0;
+    for (uint32_t v = 0; v < vcount; v++)
+        if (cga_graph_degree(graph, v) > max_degree) max_degree = cga_graph_degree(graph, v);
+    order_key_t *buf = malloc((max_degree ? max_degree : 1) * sizeof(order_key_t));
+    if (seq == NULL || visited == NULL || buf == NULL) {
+        free(seq);
+        free(visited);
+        free(buf);
+        free(keys);
+        return NOMEM;
+    }
+    uint32_t len = 0;
+    for (uint32_t k = 0; k < vcount; k++) {  // one breadth first search for each connected component
+        if (!visited[keys[k].id])
+            len = bfs_order(graph, keys[k].id, visited, seq, len, buf, order == CGA_ORDER_RCM);
+    }
+    for (uint32_t k = 0; k < vcount; k++)
+        perm[seq[k]] = (order == CGA_ORDER_RCM) ? vcount - 1 - k : k;
+    free(seq);
+    free(visited);
+    free(buf);
+    free(keys);
+    return SUCCESS;
+}
+
+cga_status_t cga_graph_permute(cga_graph_t *graph, cga_hashtable_t *ht, const uint32_t *perm) {
+    uint32_t vcount = cga_graph_vcount(graph);
+    uint32_t *inv = malloc((vcount ? vcount : 1) * sizeof(uint32_t));
+    if (inv == NULL)
+        return NOMEM;
+    memset(inv, 0xff, (vcount ? vcount : 1) * sizeof(uint32_t));
+    for (uint32_t v = 0; v < vcount; v++) {
+        if (perm[v] >= vcount || inv[perm[v]] != UINT32_MAX) {
+            free(inv);
+            return WRFORMAT;
+        }
+        inv[perm[v]] = v;
+    }
+
+    uint32_t *offsets = malloc(((size_t)vcount + 1) * sizeof(uint32_t));
+    uint32_t *adj = malloc((graph->ecount ? graph->ecount : 1) * sizeof(uint32_t));
+    unsigned long *labels = malloc((vcount ? vcount : 1) * sizeof(unsigned long));
+    cga_asn_index_t *index = (graph->index != NULL) ? malloc((vcount ? vcount : 1) * sizeof(cga_asn_index_t)) : NULL;
+    if (offsets == NULL || adj == NULL || labels == NULL || (graph->index != NULL && index == NULL)) {
+        free(inv);
+        free(offsets);
+        free(adj);
+        free(labels);
+        free(index);
+        return NOMEM;
+    }
+    offsets[0] = 0;
+    for (uint32_t n = 0; n < vcount; n++) {
+        uint32_t v = inv[n], begin = offsets[n];
+        for (uint32_t i = graph->offsets[v]; i < graph->offsets[v + 1]; i++)
+            adj[begin + i - graph->offsets[v]] = CGA_ADJ_PACK(perm[CGA_ADJ_VERTEX(graph->adj[i])], CGA_ADJ_REL(graph->adj[i]));
+        offsets[n + 1] = begin + cga_graph_degree(graph, v);
+        cga_graph_sort_adj(&adj[begin], offsets[n + 1] - begin);  // keep the lists sorted
+        labels[n] = graph->labels[v];
+    }
+    if (index != NULL) {  // the index stays sorted by as_number, only the vertex_ids change
+        for (uint32_t k = 0; k < vcount; k++) {
+            index[k] = graph->index[k];
+            index[k].id = perm[graph->index[k].id];
+        }
+    }
+    if (ht != NULL) {  // every entry, also the as_numbers of ht that aren't labels of the graph
+        perm_map_t map = {perm, vcount};
+        cga_ht_foreach(ht, remap_vertex, &map);
+    }
+    free(inv);
+
+    if (graph->mapping != NULL) {
+        munmap(graph->mapping, graph->mapping_size);
+        graph->mapping = NULL;
+        graph->mapping_size = 0;
+    } else {
+        free(graph->offsets);
+        free(graph->adj);
+        free(graph->labels);
+        free(graph->index);
+    }
+    graph->offsets = offsets;
+    graph->adj = adj;
+    graph->labels = labels;
+    graph->index = index;
+    return SUCCESS;
+}
+
+cga_status_t cga_graph_reorder(cga_graph_t *graph, cga_hashtable_t *ht, cga_order_t order) {
+    uint32_t *perm = malloc((cga_graph_vcount(graph) ? cga_graph_vcount(graph) : 1) * sizeof(uint32_t));
+    if (perm == NULL)
+        return NOMEM;
+    cga_stats_phase_begin(CGA_PHASE_BUILD);
+    cga_status_t status = cga_graph_order(graph, order, perm);
+    if (status == SUCCESS)
+        status = cga_graph_permute(graph, ht, perm);
+    cga_stats_phase_end(CGA_PHASE_BUILD);
+    free(perm);
+    return status;
+}
+
+/**
+ * Sorts the vertices by customer cone size and degree if cones is not NULL, by degree otherwise.
+ * The ties keep the old order of the vertex_ids.
+ *
+ * Returns the array of the sorted vertices, NULL if there's not enough memory
+ */
+static order_key_t *sorted_vertices(const cga_graph_t *graph, const cga_cones_t *cones, int descending) {
+    uint32_t vcount = cga_graph_vcount(graph);
+    order_key_t *keys = malloc((vcount ? vcount : 1) * sizeof(order_key_t));
+    if (keys == NULL)
+        return NULL;
+    for (uint32_t v = 0; v < vcount; v++) {
+        keys[v].id = v;
+        keys[v].key = cga_graph_degree(graph, v);
+        if (cones != NULL) keys[v].key |= (uint64_t)cga_cones_size(cones, v) << 32;
+    }
+    qsort(keys, vcount, sizeof(order_key_t), descending ? cmp_key_desc : cmp_key_asc);
+    return keys;
+}
+
+/**
+ * Appends to seq[0..len) the vertices of the connected component of source in breadth first
+ * order, using seq itself as the queue. If by_degree is not 0 the neighbors of each vertex are
+ * appended by increasing degree (Cuthill-McKee), buf holding them while they are sorted.
+ *
+ * Returns the new length of seq
+ */
+static uint32_t bfs_order(const cga_graph_t *graph, uint32_t source, uint8_t *visited, uint32_t *seq, uint32_t len, order_key_t *buf, int by_degree) {
+    uint32_t head = len;
+    visited[source] = 1;
+    seq[len++] = source;
+    while (head < len) {
+        uint32_t v = seq[head++], nbuf = 0;
+        for (uint32_t i = graph->offsets[v]; i < graph->offsets[v + 1]; i++) {
+            uint32_t w = CGA_ADJ_VERTEX(graph->adj[i]);
+            if (visited[w]) continue;
+            visited[w] = 1;
+            buf[nbuf].id = w;
+            buf[nbuf++].key = cga_graph_degree(graph, w);
+        }
+        if (by_degree)
+            qsort(buf, nbuf, sizeof(order_key_t), cmp_key_asc);
+        for (uint32_t k = 0; k < nbuf; k++)
+            seq[len++] = buf[k].id;
+    }
+    return len;
+}
+
+/**
+ * Comparison function used to sort the vertices by decreasing key, then by increasing vertex_id
+ */
+static int cmp_key_desc(const void *a, const void *b) {
+    const order_key_t *x = a, *y = b;
+    if (x->key != y->key)
+        return (x->key < y->key) - (x->key > y->key);
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+/**
+ * Comparison function used to sort the vertices by increasing key, then by increasing vertex_id
+ */
+static int cmp_key_asc(const void *a, const void *b) {
+    const order_key_t *x = a, *y = b;
+    if (x->key != y->key)
+        return (x->key > y->key) - (x->key < y->key);
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+/**
+ * Visitor of cga_ht_foreach that renumbers the vertex_id of an as_number; arg is the perm_map_t.
+ * The values that are not vertex_ids of the graph are left as they are.
+ */
+static void remap_vertex(unsigned long key, igraph_integer_t *value, void *arg) {
+    (void)key;
+    const perm_map_t *map = arg;
+    if (*value >= 0 && *value < (igraph_integer_t)map->vcount)
+        *value = map->perm[*value];
+}
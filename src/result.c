@@ -0,0 +1,359 @@
+#include "result.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "pairs.h"
+#include "writer.h"
+
+/**
+ * Binary result file being merged: its records are sorted in place in the mapped file, then
+ * consumed from cursor.
+ */
+typedef struct _result_run {
+    pthread_t t_id;
+    const char *path;
+    cga_status_t status;
+    cga_pairs_header_t header;
+    char *mapping;
+    size_t mapping_size;
+    cga_pair_record_t *records;
+    size_t count;
+    size_t cursor;
+} result_run_t;
+
+static void *run_sort_job(void *attr);
+static cga_status_t merge_runs(result_run_t *runs, unsigned int nruns, const char *path);
+static void heap_sift_down(result_run_t *runs, unsigned int *heap, unsigned int size, unsigned int k);
+static uint64_t record_key(const cga_pair_record_t *record);
+static const cga_pair_record_t *search_record(const cga_result_t *result, uint32_t from, uint32_t to);
+static uint64_t align8(uint64_t off);
+static int cmp_record(const void *a, const void *b);
+
+cga_status_t cga_result_build(const char *const *paths, unsigned int npaths, const char *path) {
+    result_run_t *runs = calloc(npaths ? npaths : 1, sizeof(result_run_t));
+    if (runs == NULL)
+        return NOMEM;
+    // the files are independent, so they are sorted in parallel
+    unsigned int started = 0;
+    for (unsigned int i = 0; i < npaths; i++, started++) {
+        runs[i].path = paths[i];
+        if (pthread_create(&runs[i].t_id, NULL, run_sort_job, &runs[i]) != 0)
+            break;
+    }
+    for (unsigned int i = started; i < npaths; i++)  // threads not available, sort here
+        run_sort_job(&runs[i]);
+    for (unsigned int i = 0; i < started; i++)
+        pthread_join(runs[i].t_id, NULL);
+
+    cga_status_t status = SUCCESS;
+    for (unsigned int i = 0; i < npaths && status == SUCCESS; i++) {
+        status = runs[i].status;
+        // merging results of different graphs or options would give a meaningless file
+        if (status == SUCCESS && (runs[i].header.fingerprint != runs[0].header.fingerprint || runs[i].header.flags != runs[0].header.flags))
+            status = WRFORMAT;
+    }
+    if (status == SUCCESS)
+        status = merge_runs(runs, npaths, path);
+    for (unsigned int i = 0; i < npaths; i++) {
+        if (runs[i].mapping != NULL)
+            munmap(runs[i].mapping, runs[i].mapping_size);
+    }
+    free(runs);
+    return status;
+}
+
+cga_status_t cga_result_open(cga_result_t *result, const char *path) {
+    memset(result, 0, sizeof(cga_result_t));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NRPERM;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(cga_result_header_t)) {
+        close(fd);
+        return WRFORMAT;
+    }
+    char *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  // the mapping keeps the file open
+    if (data == MAP_FAILED)
+        return NRPERM;
+
+    // check that the header describes sections fully contained in the file
+    const cga_result_header_t *header = (const cga_result_header_t *)data;
+    if (memcmp(header->magic, CGA_RESULT_MAGIC, sizeof(CGA_RESULT_MAGIC)) != 0
+        || header->version != CGA_RESULT_VERSION || header->header_size != sizeof(cga_result_header_t)
+        || header->record_size != sizeof(cga_pair_record_t) || header->file_size != (uint64_t)st.st_size
+        || header->records_off % 8 || header->sources_off % 8 || header->records_off < sizeof(cga_result_header_t)
+        || header->count > header->file_size / sizeof(cga_pair_record_t)
+        || header->nsources > header->file_size / sizeof(cga_result_source_t)
+        || header->records_off + header->count * sizeof(cga_pair_record_t) > header->sources_off
+        || header->sources_off + (header->nsources + 1) * sizeof(cga_result_source_t) > header->file_size) {
+        munmap(data, st.st_size);
+        return WRFORMAT;
+    }
+    result->header = header;
+    result->records = (const cga_pair_record_t *)(data + header->records_off);
+    result->sources = (const cga_result_source_t *)(data + header->sources_off);
+    // the offset table must be sorted and within the records, as cga_result_source trusts it
+    int ok = result->sources[0].first == 0 && result->sources[header->nsources].first == header->count;
+    for (uint64_t k = 0; ok && k < header->nsources; k++)
+        ok = result->sources[k].first <= result->sources[k + 1].first
+            && (k == 0 || result->sources[k - 1].asn < result->sources[k].asn);
+    if (!ok) {
+        memset(result, 0, sizeof(cga_result_t));
+        munmap(data, st.st_size);
+        return WRFORMAT;
+    }
+    result->mapping = data;
+    result->mapping_size = st.st_size;
+    return SUCCESS;
+}
+
+void cga_result_close(cga_result_t *result) {
+    if (result->mapping != NULL)
+        munmap(result->mapping, result->mapping_size);
+    memset(result, 0, sizeof(cga_result_t));
+}
+
+int cga_result_match(const cga_result_t *result, const cga_graph_t *graph) {
+    return result->header->fingerprint == cga_graph_fingerprint(graph)
+        && result->header->vcount == graph->vcount && result->header->ecount == graph->ecount;
+}
+
+const cga_pair_record_t *cga_result_source(const cga_result_t *result, uint32_t from, size_t *count) {
+    uint64_t lo = 0, hi = result->header->nsources;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (result->sources[mid].asn == from) {
+            *count = result->sources[mid + 1].first - result->sources[mid].first;
+            return &result->records[result->sources[mid].first];
+        }
+        if (result->sources[mid].asn < from)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *count = 0;
+    return NULL;
+}
+
+int cga_result_find(const cga_result_t *result, uint32_t from, uint32_t to, cga_pair_record_t *record) {
+    const cga_pair_record_t *found = search_record(result, from, to);
+    if (found != NULL) {
+        *record = *found;
+        return 1;
+    }
+    if (!(result->header->flags & CGA_PAIRS_SYMMETRIC) || (found = search_record(result, to, from)) == NULL)
+        return 0;
+    // the stored record is <to, from>: same lengths, opposite costs
+    *record = *found;
+    record->from = from;
+    record->to = to;
+    if (found->avg_cost != 0) record->avg_cost = -found->avg_cost;
+    record->cost_min = -found->cost_max;
+    record->cost_max = -found->cost_min;
+    return 1;
+}
+
+/**
+ * Thread sorting a binary result file in place: maps it writable, checks the header and sorts
+ * the records by <from, to>. The outcome is stored in the status of the run.
+ */
+static void *run_sort_job(void *attr) {
+    result_run_t *run = (result_run_t *)attr;
+    int fd = open(run->path, O_RDWR);
+    if (fd < 0) {
+        run->status = NRPERM;
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(cga_pairs_header_t)) {
+        close(fd);
+        run->status = WRFORMAT;
+        return NULL;
+    }
+    char *data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);  // the mapping keeps the file open
+    if (data == MAP_FAILED) {
+        run->status = NRPERM;
+        return NULL;
+    }
+    run->mapping = data;
+    run->mapping_size = st.st_size;
+    memcpy(&run->header, data, sizeof(cga_pairs_header_t));
+    if (memcmp(run->header.magic, CGA_PAIRS_MAGIC, sizeof(CGA_PAIRS_MAGIC)) != 0 || run->header.version != CGA_PAIRS_VERSION
+        || run->header.header_size != sizeof(cga_pairs_header_t) || run->header.record_size != sizeof(cga_pair_record_t)) {
+        run->status = WRFORMAT;
+        return NULL;
+    }
+    run->records = (cga_pair_record_t *)(data + run->header.header_size);
+    run->count = (st.st_size - run->header.header_size) / sizeof(cga_pair_record_t);  // a partial record is ignored
+    qsort(run->records, run->count, sizeof(cga_pair_record_t), cmp_record);
+    run->status = SUCCESS;
+    return NULL;
+}
+
+/**
+ * Merges the sorted runs in the indexed result file path, writing the records in order with a
+ * min-heap of the runs keyed by their next record and building the offset table on the way.
+ * The header is written last, once the counts are known.
+ *
+ * Returns SUCCESS if the operation completed without errors, NOMEM if there's not enough memory,
+ * NWPERM if the file can't be written
+ */
+static cga_status_t merge_runs(result_run_t *runs, unsigned int nruns, const char *path) {
+    size_t nalloc = 1024, nsources = 0;
+    cga_result_source_t *sources = malloc(nalloc * sizeof(cga_result_source_t));
+    unsigned int *heap = malloc((nruns ? nruns : 1) * sizeof(unsigned int));
+    int size = snprintf(NULL, 0, "%s.tmp", path);
+    char *tmp_path = malloc(size + 1);
+    if (sources == NULL || heap == NULL || tmp_path == NULL) {
+        free(sources);
+        free(heap);
+        free(tmp_path);
+        return NOMEM;
+    }
+    snprintf(tmp_path, size + 1, "%s.tmp", path);
+    cga_writer_t out;
+    cga_status_t status = cga_writer_open(&out, tmp_path);
+    if (status != SUCCESS) {
+        free(sources);
+        free(heap);
+        free(tmp_path);
+        return status;
+    }
+
+    cga_result_header_t header;
+    memset(&header, 0, sizeof(header));
+    cga_writer_write(&out, (const char *)&header, sizeof(header));  // placeholder, rewritten at the end
+    header.records_off = align8(sizeof(header));
+    for (uint64_t pad = sizeof(header); pad < header.records_off; pad++)
+        cga_writer_putc(&out, 0);
+
+    unsigned int heap_size = 0;
+    for (unsigned int i = 0; i < nruns; i++) {
+        if (runs[i].count > 0) heap[heap_size++] = i;
+    }
+    for (unsigned int k = heap_size / 2; k-- > 0;)
+        heap_sift_down(runs, heap, heap_size, k);
+    uint64_t count = 0;
+    while (heap_size > 0 && status == SUCCESS) {
+        result_run_t *run = &runs[heap[0]];
+        const cga_pair_record_t *record = &run->records[run->cursor++];
+        if (nsources == 0 || sources[nsources - 1].asn != record->from) {  // first record of a source
+            if (nsources + 1 == nalloc) {  // always room for the sentinel
+                cga_result_source_t *tmp = realloc(sources, 2 * nalloc * sizeof(cga_result_source_t));
+                if (tmp == NULL) {
+                    status = NOMEM;
+                    break;
+                }
+                sources = tmp;
+                nalloc *= 2;
+            }
+            sources[nsources].asn = record->from;
+            sources[nsources].reserved = 0;
+            sources[nsources++].first = count;
+        }
+        cga_writer_write(&out, (const char *)record, sizeof(cga_pair_record_t));
+        count++;
+        if (run->cursor == run->count)
+            heap[0] = heap[--heap_size];
+        heap_sift_down(runs, heap, heap_size, 0);
+    }
+    sources[nsources].asn = UINT32_MAX;
+    sources[nsources].reserved = 0;
+    sources[nsources].first = count;
+
+    memcpy(header.magic, CGA_RESULT_MAGIC, sizeof(CGA_RESULT_MAGIC));
+    header.version = CGA_RESULT_VERSION;
+    header.header_size = sizeof(header);
+    header.record_size = sizeof(cga_pair_record_t);
+    header.flags = nruns > 0 ? runs[0].header.flags : 0;
+    header.fingerprint = nruns > 0 ? runs[0].header.fingerprint : 0;
+    header.vcount = nruns > 0 ? runs[0].header.vcount : 0;
+    header.ecount = nruns > 0 ? runs[0].header.ecount : 0;
+    header.count = count;
+    header.nsources = nsources;
+    header.sources_off = align8(header.records_off + count * sizeof(cga_pair_record_t));
+    header.file_size = header.sources_off + (nsources + 1) * sizeof(cga_result_source_t);
+    for (uint64_t pad = header.records_off + count * sizeof(cga_pair_record_t); pad < header.sources_off; pad++)
+        cga_writer_putc(&out, 0);
+    cga_writer_write(&out, (const char *)sources, (nsources + 1) * sizeof(cga_result_source_t));
+    if (cga_writer_flush(&out) == SUCCESS && status == SUCCESS && pwrite(out.fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+        status = NWPERM;
+    cga_status_t written = cga_writer_close(&out);
+    if (status == SUCCESS) status = written;
+    if (status == SUCCESS && rename(tmp_path, path) != 0) status = NWPERM;
+    if (status != SUCCESS) remove(tmp_path);
+    free(sources);
+    free(heap);
+    free(tmp_path);
+    return status;
+}
+
+/**
+ * Restores the min-heap property of the runs in heap[0..size) from position k down
+ */
+static void heap_sift_down(result_run_t *runs, unsigned int *heap, unsigned int size, unsigned int k) {
+    for (;;) {
+        unsigned int smallest = k, left = 2 * k + 1, right = 2 * k + 2;
+        if (left < size && record_key(&runs[heap[left]].records[runs[heap[left]].cursor]) < record_key(&runs[heap[smallest]].records[runs[heap[smallest]].cursor]))
+            smallest = left;
+        if (right < size && record_key(&runs[heap[right]].records[runs[heap[right]].cursor]) < record_key(&runs[heap[smallest]].records[runs[heap[smallest]].cursor]))
+            smallest = right;
+        if (smallest == k)
+            return;
+        unsigned int tmp = heap[k];
+        heap[k] = heap[smallest];
+        heap[smallest] = tmp;
+        k = smallest;
+    }
+}
+
+/**
+ * Sort key of a record: <from, to> in a single integer
+ */
+static uint64_t record_key(const cga_pair_record_t *record) {
+    return ((uint64_t)record->from << 32) | record->to;
+}
+
+/**
+ * Binary search of the record <from, to> among the records of the source from.
+ *
+ * Returns a pointer to the record, NULL if it is not in the file
+ */
+static const cga_pair_record_t *search_record(const cga_result_t *result, uint32_t from, uint32_t to) {
+    size_t count;
+    const cga_pair_record_t *records = cga_result_source(result, from, &count);
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (records[mid].to == to)
+            return &records[mid];
+        if (records[mid].to < to)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return NULL;
+}
+
+/**
+ * Rounds off up to a multiple of 8
+ */
+static uint64_t align8(uint64_t off) {
+    return (off + 7) & ~(uint64_t)7;
+}
+
+/**
+ * Comparison function used to sort the records by <from, to>
+ */
+static int cmp_record(const void *a, const void *b) {
+    uint64_t x = record_key(a), y = record_key(b);
+    return (x > y) - (x < y);
+}
@@ -0,0 +1,655 @@
+#include "sampling.h"
+#include <igraph/igraph.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "graph.h"
+#include "scheduler.h"
+#include "visited.h"
+#include "writer.h"
+
+/**
+ * State of a xoshiro256** generator.
+ */
+typedef struct _mc_rng {
+    uint64_t s[4];
+} mc_rng_t;
+
+/**
+ * Sums over the walks of a batch. For the path statistics x is the weight of the walk, y the
+ * weight times the length and z the weight times the cost; for the degree of freedom x is the
+ * weight of the valley free walks and y the weight of the other ones (z is not used). The walks
+ * that don't reach the target have weight 0 and only count in n.
+ */
+typedef struct _mc_acc {
+    uint64_t n;
+    uint64_t hits;
+    double sx, sxx;
+    double sy, syy, sxy;
+    double sz, szz, sxz;
+    int length_min;
+    int length_max;
+    int cost_min;
+    int cost_max;
+    double length_hist[CGA_MC_MAX_LENGTH + 1];
+    double cost_hist[2 * CGA_MC_MAX_LENGTH + 1];
+} mc_acc_t;
+
+/**
+ * Estimation shared by the threads: the batches are the tasks of sched and each one stores
+ * its sums in accs[batch].
+ */
+typedef struct _mc_job {
+    cga_graph_t *graph;
+    const cga_dfs_ctx_t *ctx;
+    igraph_integer_t from;
+    igraph_integer_t to;
+    const cga_mc_opts_t *opts;
+    int freedom;
+    uint32_t max_degree;
+    cga_sched_t *sched;
+    mc_acc_t *accs;
+} mc_job_t;
+
+/**
+ * Buffers of a thread: the vertices of the current walk and the candidates of the next hop.
+ */
+typedef struct _mc_walker {
+    cga_visited_t used_nodes;
+    uint32_t *cand;
+} mc_walker_t;
+
+struct mc_tinfo {
+    pthread_t t_id;
+    mc_job_t *job;
+    unsigned int worker;
+};
+
+/**
+ * Thread of cga_graph_analysis_mc.
+ */
+struct mc_analysis_tinfo {
+    pthread_t t_id;
+    char *filename;
+    cga_graph_t *graph;
+    cga_sched_t *sched;
+    unsigned int worker;
+    const cga_mc_opts_t *opts;
+    uint32_t max_degree;
+    cga_status_t status;  // set by the job if its output file can't be opened or written
+};
+
+static uint64_t splitmix64(uint64_t *x);
+static void rng_seed(mc_rng_t *rng, uint64_t seed, uint64_t stream);
+static uint64_t rng_next(mc_rng_t *rng);
+static uint32_t rng_below(mc_rng_t *rng, uint32_t n);
+static void acc_init(mc_acc_t *acc);
+static void acc_merge(mc_acc_t *dst, const mc_acc_t *src);
+static cga_mc_estimate_t estimate_mean(uint64_t n, double s, double ss, double z);
+static cga_mc_estimate_t estimate_ratio(uint64_t n, double sy, double syy, double sx, double sxx, double sxy, double z);
+static uint32_t graph_max_degree(const cga_graph_t *graph);
+static int walker_init(mc_walker_t *walker, uint32_t vcount, uint32_t max_degree);
+static void walker_destroy(mc_walker_t *walker);
+static int mc_walk(const mc_job_t *job, mc_walker_t *walker, mc_rng_t *rng, double *weight, int *length, int *cost, int *state);
+static void mc_batch(const mc_job_t *job, mc_walker_t *walker, uint32_t batch, mc_acc_t *acc);
+static void *mc_job_thread(void *attr);
+static cga_status_t mc_run(mc_job_t *job, mc_walker_t *walker, mc_acc_t *total);
+static cga_status_t mc_path_stats(mc_job_t *job, mc_walker_t *walker, cga_mc_result_t *res);
+static void *cga_graph_analysis_mc_job(void *attr);
+static void print_mc_row(cga_writer_t *out, const cga_graph_t *graph, uint32_t from, uint32_t to, const cga_mc_result_t *res);
+
+void cga_mc_opts_init(cga_mc_opts_t *opts) {
+    opts->samples = 10000;
+    opts->seed = 1;
+    opts->nthreads = 1;
+    opts->z = 1.96;
+    opts->max_hops = 0;
+}
+
+cga_status_t cga_mc_path_stats(cga_graph_t *graph, cga_dfs_ctx_t *ctx, igraph_integer_t from, igraph_integer_t to, const cga_mc_opts_t *opts, cga_mc_result_t *res) {
+    cga_mc_opts_t defaults;
+    if (opts == NULL) {
+        cga_mc_opts_init(&defaults);
+        opts = &defaults;
+    }
+    cga_dfs_ctx_t *own = NULL;
+    if (ctx == NULL) {
+        own = ctx = cga_dfs_ctx_init(graph);
+        if (ctx == NULL)
+            return NOMEM;
+    }
+    cga_dfs_ctx_set_target(ctx, to);  // the threads only read the table
+    mc_job_t job = {.graph = graph, .ctx = ctx, .from = from, .to = to, .opts = opts, .freedom = 0, .max_degree = graph_max_degree(graph)};
+    cga_status_t status = mc_path_stats(&job, NULL, res);
+    if (own != NULL)
+        cga_dfs_ctx_destroy(own);
+    return status;
+}
+
+cga_status_t cga_mc_degree_freedom(cga_graph_t *graph, igraph_integer_t from, igraph_integer_t to, const cga_mc_opts_t *opts, cga_mc_freedom_t *res) {
+    cga_mc_opts_t defaults;
+    if (opts == NULL) {
+        cga_mc_opts_init(&defaults);
+        opts = &defaults;
+    }
+    mc_job_t job = {.graph = graph, .ctx = NULL, .from = from, .to = to, .opts = opts, .freedom = 1, .max_degree = graph_max_degree(graph)};
+    mc_acc_t total;
+    cga_status_t status = mc_run(&job, NULL, &total);
+    if (status != SUCCESS)
+        return status;
+    res->samples = total.n;
+    res->hits = total.hits;
+    res->vfree = estimate_mean(total.n, total.sx, total.sxx, opts->z);
+    res->novfree = estimate_mean(total.n, total.sy, total.syy, opts->z);
+    res->ratio = estimate_ratio(total.n, total.sx, total.sxx, total.sy, total.syy, total.sxy, opts->z);
+    return SUCCESS;
+}
+
+cga_status_t cga_graph_analysis_mc(cga_graph_t *graph, unsigned int nthreads, char *filename, const cga_mc_opts_t *opts) {
+    cga_mc_opts_t defaults;
+    if (opts == NULL) {
+        cga_mc_opts_init(&defaults);
+        opts = &defaults;
+    }
+    // every pair costs about the same number of hops, so the targets are not weighted
+    uint32_t vcount = cga_graph_vcount(graph), ntasks = 0;
+    uint32_t *tasks = malloc((vcount ? vcount : 1) * sizeof(uint32_t));
+    if (tasks == NULL)
+        return NOMEM;
+    for (uint32_t v = 0; v < vcount; v++) {
+        if (cga_graph_degree(graph, v) == 0) continue;  // the node is unreachable
+        tasks[ntasks++] = v;
+    }
+    cga_sched_t *sched = cga_sched_init(nthreads, tasks, NULL, ntasks);
+    free(tasks);
+    if (sched == NULL)
+        return NOMEM;
+    uint32_t max_degree = graph_max_degree(graph);
+
+    struct mc_analysis_tinfo *ti = calloc(nthreads, sizeof(struct mc_analysis_tinfo));
+    if (ti == NULL) {
+        cga_sched_destroy(sched);
+        return NOMEM;
+    }
+    unsigned int started = 0;
+    cga_status_t status = SUCCESS;
+    for (unsigned int i = 0; i < nthreads; i++) {
+        ti[i].graph = graph;
+        ti[i].sched = sched;
+        ti[i].worker = i;
+        ti[i].opts = opts;
+        ti[i].max_degree = max_degree;
+        int size = snprintf(NULL, 0, "%s_%u.csv", filename, i);
+        ti[i].filename = malloc(size + 1);
+        if (ti[i].filename == NULL) {
+            status = NOMEM;
+            break;
+        }
+        snprintf(ti[i].filename, size + 1, "%s_%u.csv", filename, i);
+        if (pthread_create(&ti[i].t_id, NULL, cga_graph_analysis_mc_job, &ti[i]) != 0) {
+            status = NOMEM;
+            break;
+        }
+        started++;
+    }
+    for (unsigned int i = 0; i < started; i++) {
+        pthread_join(ti[i].t_id, NULL);
+        if (status == SUCCESS)  // the first job whose output is incomplete
+            status = ti[i].status;
+    }
+    for (unsigned int i = 0; i < nthreads; i++) {
+        free(ti[i].filename);
+    }
+    free(ti);
+    cga_sched_destroy(sched);
+    return status;
+}
+
+static void *cga_graph_analysis_mc_job(void *attr) {
+    struct mc_analysis_tinfo *ti = (struct mc_analysis_tinfo *)attr;
+
+    cga_writer_t out;
+    if ((ti->status = cga_writer_open(&out, ti->filename)) != SUCCESS)
+        return NULL;
+    cga_writer_puts(&out, "from, to, paths, paths low, paths high, avg length, avg length low, avg length high, "
+                          "avg cost, avg cost low, avg cost high, min length, max length, min cost, max cost, hits\n");
+    cga_dfs_ctx_t *ctx = cga_dfs_ctx_init(ti->graph);
+    if (ctx == NULL) {
+        fprintf(stderr, "%s", "Out of memory while allocating the DFS context. Aborting process...");
+        abort();
+    }
+    mc_walker_t walker;  // reused by all the pairs of the thread
+    if (walker_init(&walker, cga_graph_vcount(ti->graph), ti->max_degree) != 0) {
+        fprintf(stderr, "%s", "Out of memory while allocating the walker. Aborting process...");
+        abort();
+    }
+    cga_mc_opts_t opts = *ti->opts;
+    opts.nthreads = 1;  // the pairs are already spread among the threads
+    uint32_t j;
+    while (cga_sched_next(ti->sched, ti->worker, &j)) {
+        cga_dfs_ctx_set_target(ctx, j);
+        for (uint32_t i = 0; i < cga_graph_vcount(ti->graph); i++) {
+            if (i == j) continue;  // same node, not needed for analysis
+            if (cga_graph_degree(ti->graph, i) == 0) continue;  // the node is unreachable
+            if (!cga_dfs_ctx_reachable(ctx, i, j)) continue;  // there's no valley free path
+            uint64_t pair = ((uint64_t)i << 32) | j;
+            opts.seed = ti->opts->seed ^ splitmix64(&pair);
+            mc_job_t job = {.graph = ti->graph, .ctx = ctx, .from = i, .to = j, .opts = &opts, .freedom = 0, .max_degree = ti->max_degree};
+            cga_mc_result_t res;
+            if (mc_path_stats(&job, &walker, &res) != SUCCESS) {
+                fprintf(stderr, "%s", "Out of memory while sampling the paths. Aborting process...");
+                abort();
+            }
+            print_mc_row(&out, ti->graph, i, j, &res);
+        }
+    }
+    walker_destroy(&walker);
+    cga_dfs_ctx_destroy(ctx);
+    ti->status = cga_writer_close(&out);
+    return NULL;
+}
+
+/**
+ * Prints the row of the estimates of the pair <from, to>, with the columns described in
+ * cga_graph_analysis_mc and 3 decimals for the real values.
+ */
+static void print_mc_row(cga_writer_t *out, const cga_graph_t *graph, uint32_t from, uint32_t to, const cga_mc_result_t *res) {
+    const cga_mc_estimate_t *estimates[3] = {&res->paths, &res->avg_length, &res->avg_cost};
+    cga_writer_uint(out, cga_graph_label(graph, from));
+    cga_writer_putc(out, ',');
+    cga_writer_uint(out, cga_graph_label(graph, to));
+    for (int k = 0; k < 3; k++) {
+        cga_writer_putc(out, ',');
+        cga_writer_fixed(out, estimates[k]->value, 3);
+        cga_writer_putc(out, ',');
+        cga_writer_fixed(out, estimates[k]->low, 3);
+        cga_writer_putc(out, ',');
+        cga_writer_fixed(out, estimates[k]->high, 3);
+    }
+    const int bounds[4] = {res->length_min, res->length_max, res->cost_min, res->cost_max};
+    for (int k = 0; k < 4; k++) {
+        cga_writer_putc(out, ',');
+        cga_writer_int(out, bounds[k]);
+    }
+    cga_writer_putc(out, ',');
+    cga_writer_uint(out, res->hits);
+    cga_writer_putc(out, '\n');
+}
+
+/**
+ * Estimates the path statistics of job, whose context already has the reachability table of
+ * job->to, and stores them in res. walker, if not NULL, is used when the samples are taken by a
+ * single thread, so the callers estimating many pairs allocate it once.
+ */
+static cga_status_t mc_path_stats(mc_job_t *job, mc_walker_t *walker, cga_mc_result_t *res) {
+    const cga_mc_opts_t *opts = job->opts;
+    mc_acc_t total;
+    cga_status_t status = mc_run(job, walker, &total);
+    if (status != SUCCESS)
+        return status;
+
+    uint64_t n = total.n;
+    res->samples = n;
+    res->hits = total.hits;
+    res->paths = estimate_mean(n, total.sx, total.sxx, opts->z);
+    res->avg_length = estimate_ratio(n, total.sy, total.syy, total.sx, total.sxx, total.sxy, opts->z);
+    res->avg_cost = estimate_ratio(n, total.sz, total.szz, total.sx, total.sxx, total.sxz, opts->z);
+    res->length_min = total.hits ? total.length_min : 0;
+    res->length_max = total.hits ? total.length_max : 0;
+    res->cost_min = total.hits ? total.cost_min : 0;
+    res->cost_max = total.hits ? total.cost_max : 0;
+    for (int i = 0; i <= CGA_MC_MAX_LENGTH; i++)
+        res->length_hist[i] = n ? total.length_hist[i] / n : 0;
+    for (int i = 0; i <= 2 * CGA_MC_MAX_LENGTH; i++)
+        res->cost_hist[i] = n ? total.cost_hist[i] / n : 0;
+    return SUCCESS;
+}
+
+/**
+ * Splits the samples of job in batches, runs them on opts->nthreads threads and merges the sums
+ * of the batches, in order, into total. With a single thread the batches run here, one after the
+ * other, with walker (or a walker of its own if it is NULL) and without a scheduler.
+ */
+static cga_status_t mc_run(mc_job_t *job, mc_walker_t *walker, mc_acc_t *total) {
+    const cga_mc_opts_t *opts = job->opts;
+    unsigned int nthreads = opts->nthreads ? opts->nthreads : 1;
+    uint64_t nbatches = (opts->samples + CGA_MC_BATCH - 1) / CGA_MC_BATCH;
+    if (nbatches > UINT32_MAX)
+        nbatches = UINT32_MAX;  // the batch ids are 32 bits tasks of the scheduler
+    acc_init(total);
+    if (nbatches == 0)
+        return SUCCESS;
+
+    if (nthreads == 1) {
+        mc_walker_t own;
+        if (walker == NULL) {
+            if (walker_init(&own, cga_graph_vcount(job->graph), job->max_degree) != 0)
+                return NOMEM;
+            walker = &own;
+        }
+        mc_acc_t acc;
+        for (uint64_t b = 0; b < nbatches; b++) {
+            mc_batch(job, walker, b, &acc);
+            acc_merge(total, &acc);
+        }
+        if (walker == &own)
+            walker_destroy(&own);
+        return SUCCESS;
+    }
+    uint32_t *tasks = malloc(nbatches * sizeof(uint32_t));
+    job->accs = malloc(nbatches * sizeof(mc_acc_t));
+    if (tasks == NULL || job->accs == NULL) {
+        free(tasks);
+        free(job->accs);
+        return NOMEM;
+    }
+    for (uint64_t b = 0; b < nbatches; b++)
+        tasks[b] = b;
+    job->sched = cga_sched_init(nthreads, tasks, NULL, nbatches);
+    free(tasks);
+    if (job->sched == NULL) {
+        free(job->accs);
+        return NOMEM;
+    }
+
+    cga_status_t status = SUCCESS;
+    struct mc_tinfo *ti = calloc(nthreads, sizeof(struct mc_tinfo));
+    if (ti == NULL) {
+        status = NOMEM;
+    } else {
+        unsigned int started = 0;
+        for (unsigned int i = 0; i < nthreads; i++, started++) {
+            ti[i].job = job;
+            ti[i].worker = i;
+            if (pthread_create(&ti[i].t_id, NULL, mc_job_thread, &ti[i]) != 0)
+                break;
+        }
+        for (unsigned int i = started; i < nthreads; i++) {  // threads not available, run here
+            ti[i].job = job;
+            ti[i].worker = i;
+            if (mc_job_thread(&ti[i]) != NULL) status = NOMEM;
+        }
+        for (unsigned int i = 0; i < started; i++) {
+            void *ret;
+            pthread_join(ti[i].t_id, &ret);
+            if (ret != NULL) status = NOMEM;
+        }
+        free(ti);
+    }
+    if (status == SUCCESS) {
+        for (uint64_t b = 0; b < nbatches; b++)
+            acc_merge(total, &job->accs[b]);
+    }
+    cga_sched_destroy(job->sched);
+    free(job->accs);
+    return status;
+}
+
+/**
+ * Runs the batches assigned to a thread by the scheduler. Returns NULL on success, a non NULL
+ * value if the buffers of the thread can't be allocated.
+ */
+static void *mc_job_thread(void *attr) {
+    struct mc_tinfo *ti = (struct mc_tinfo *)attr;
+    mc_job_t *job = ti->job;
+    mc_walker_t walker;
+    if (walker_init(&walker, cga_graph_vcount(job->graph), job->max_degree) != 0) {
+        // the batches of this thread are left to the others, the whole estimation fails anyway
+        uint32_t batch;
+        while (cga_sched_next(job->sched, ti->worker, &batch))
+            acc_init(&job->accs[batch]);
+        return attr;
+    }
+    uint32_t batch;
+    while (cga_sched_next(job->sched, ti->worker, &batch))
+        mc_batch(job, &walker, batch, &job->accs[batch]);
+    walker_destroy(&walker);
+    return NULL;
+}
+
+/**
+ * Samples the walks of a batch, with the random stream of the batch, and stores their sums in acc.
+ */
+static void mc_batch(const mc_job_t *job, mc_walker_t *walker, uint32_t batch, mc_acc_t *acc) {
+    uint64_t first = (uint64_t)batch * CGA_MC_BATCH;
+    uint64_t nwalks = job->opts->samples - first < CGA_MC_BATCH ? job->opts->samples - first : CGA_MC_BATCH;
+    mc_rng_t rng;
+    rng_seed(&rng, job->opts->seed, batch);
+    acc_init(acc);
+    for (uint64_t k = 0; k < nwalks; k++) {
+        double weight;
+        int length, cost, state;
+        acc->n++;
+        if (!mc_walk(job, walker, &rng, &weight, &length, &cost, &state))
+            continue;  // weight 0, nothing to add
+        acc->hits++;
+        if (job->freedom) {
+            double x = state >= 0 ? weight : 0, y = state >= 0 ? 0 : weight;
+            acc->sx += x;
+            acc->sxx += x * x;
+            acc->sy += y;
+            acc->syy += y * y;
+            acc->sxy += x * y;
+            continue;
+        }
+        double y = weight * length, z = weight * cost;
+        acc->sx += weight;
+        acc->sxx += weight * weight;
+        acc->sy += y;
+        acc->syy += y * y;
+        acc->sxy += weight * y;
+        acc->sz += z;
+        acc->szz += z * z;
+        acc->sxz += weight * z;
+        if (length < acc->length_min) acc->length_min = length;
+        if (length > acc->length_max) acc->length_max = length;
+        if (cost < acc->cost_min) acc->cost_min = cost;
+        if (cost > acc->cost_max) acc->cost_max = cost;
+        int l = length < CGA_MC_MAX_LENGTH ? length : CGA_MC_MAX_LENGTH;
+        int c = cost < -CGA_MC_MAX_LENGTH ? -CGA_MC_MAX_LENGTH : cost > CGA_MC_MAX_LENGTH ? CGA_MC_MAX_LENGTH : cost;
+        acc->length_hist[l] += weight;
+        acc->cost_hist[CGA_MC_MAX_LENGTH + c] += weight;
+    }
+}
+
+/**
+ * Samples a random simple walk from job->from. At each step the candidates are the neighbors
+ * not yet visited that can still lead to job->to: for the valley free paths the ones from which
+ * the reachability table of the context reaches the target, for the degree of freedom all but
+ * the stub ASes (a simple path can't leave them). One of them is picked uniformly and the weight
+ * is multiplied by their number. The walk fails when there are no candidates or it gets longer
+ * than opts->max_hops.
+ *
+ * Returns 1 if the walk reached job->to, storing its weight, length, cost and the final state of
+ * the valley free automaton (-1 if not valley free), 0 otherwise.
+ */
+static int mc_walk(const mc_job_t *job, mc_walker_t *walker, mc_rng_t *rng, double *weight, int *length, int *cost, int *state) {
+    const cga_graph_t *graph = job->graph;
+    igraph_integer_t to = job->to;
+    long max_hops = job->opts->max_hops;
+    uint32_t v = job->from;
+    int st = 0, len = 0, c = 0;
+    double w = 1.0;
+    cga_vs_clear(&walker->used_nodes);
+    cga_vs_insert(&walker->used_nodes, v);
+    while (v != to) {
+        if (max_hops > 0 && len >= max_hops)
+            return 0;
+        uint32_t ncand = 0;
+        for (uint32_t i = graph->offsets[v]; i < graph->offsets[v + 1]; i++) {
+            uint32_t next = CGA_ADJ_VERTEX(graph->adj[i]);
+            if (cga_vs_contains(&walker->used_nodes, next)) continue;
+            if (job->freedom) {
+                if (next != to && cga_graph_degree(graph, next) <= 1) continue;  // dead end
+            } else {
+                int next_state = cga_vf_state(st, CGA_ADJ_REL(graph->adj[i]));
+                if (next_state < 0 || !cga_dfs_ctx_can_reach(job->ctx, next, next_state)) continue;
+            }
+            walker->cand[ncand++] = i;
+        }
+        if (ncand == 0)
+            return 0;
+        uint32_t i = walker->cand[rng_below(rng, ncand)];
+        int rel = CGA_ADJ_REL(graph->adj[i]);
+        v = CGA_ADJ_VERTEX(graph->adj[i]);
+        st = (st < 0) ? -1 : cga_vf_state(st, rel);
+        w *= ncand;
+        len++;
+        c += rel;
+        cga_vs_insert(&walker->used_nodes, v);
+    }
+    *weight = w;
+    *length = len;
+    *cost = c;
+    *state = st;
+    return 1;
+}
+
+/**
+ * The largest degree of the graph, the most candidates a step of a walk can have.
+ */
+static uint32_t graph_max_degree(const cga_graph_t *graph) {
+    uint32_t max_degree = 0;
+    for (uint32_t v = 0; v < cga_graph_vcount(graph); v++)
+        if (cga_graph_degree(graph, v) > max_degree) max_degree = cga_graph_degree(graph, v);
+    return max_degree;
+}
+
+/**
+ * Allocates the buffers of a thread. Returns 0 on success, -1 if there's not enough memory.
+ */
+static int walker_init(mc_walker_t *walker, uint32_t vcount, uint32_t max_degree) {
+    walker->cand = malloc((max_degree ? max_degree : 1) * sizeof(uint32_t));
+    if (walker->cand == NULL)
+        return -1;
+    if (cga_vs_init(&walker->used_nodes, vcount) != SUCCESS) {
+        free(walker->cand);
+        return -1;
+    }
+    return 0;
+}
+
+static void walker_destroy(mc_walker_t *walker) {
+    cga_vs_destroy(&walker->used_nodes);
+    free(walker->cand);
+}
+
+/**
+ * Estimate of the mean of n samples with sum s and sum of squares ss, with the normal confidence
+ * interval of half width z times the standard error.
+ */
+static cga_mc_estimate_t estimate_mean(uint64_t n, double s, double ss, double z) {
+    cga_mc_estimate_t e = {0, 0, 0};
+    if (n == 0)
+        return e;
+    e.value = s / n;
+    double half = 0;
+    if (n > 1) {
+        double var = (ss - n * e.value * e.value) / (n - 1);
+        half = var > 0 ? z * sqrt(var / n) : 0;
+    }
+    e.low = e.value - half;
+    e.high = e.value + half;
+    return e;
+}
+
+/**
+ * Estimate of the ratio sy / sx of two sums over the same n samples, with the confidence interval
+ * given by the delta method: the variance of the ratio R is the variance of y - R x divided by
+ * the square of the mean of x.
+ */
+static cga_mc_estimate_t estimate_ratio(uint64_t n, double sy, double syy, double sx, double sxx, double sxy, double z) {
+    cga_mc_estimate_t e = {0, 0, 0};
+    if (n == 0 || sy == 0)
+        return e;
+    e.value = sy / sx;  // as cga_degree_freedom_path, infinite if sx is 0
+    e.low = e.high = e.value;
+    if (n > 1 && sx != 0) {
+        double r = e.value, mean_x = sx / n;
+        double var = (syy - 2 * r * sxy + r * r * sxx) / (n - 1);
+        double half = var > 0 ? z * sqrt(var / n) / fabs(mean_x) : 0;
+        e.low = r - half;
+        e.high = r + half;
+    }
+    return e;
+}
+
+static void acc_init(mc_acc_t *acc) {
+    memset(acc, 0, sizeof(mc_acc_t));
+    acc->length_min = INT32_MAX;
+    acc->length_max = INT32_MIN;
+    acc->cost_min = INT32_MAX;
+    acc->cost_max = INT32_MIN;
+}
+
+static void acc_merge(mc_acc_t *dst, const mc_acc_t *src) {
+    dst->n += src->n;
+    dst->hits += src->hits;
+    dst->sx += src->sx;
+    dst->sxx += src->sxx;
+    dst->sy += src->sy;
+    dst->syy += src->syy;
+    dst->sxy += src->sxy;
+    dst->sz += src->sz;
+    dst->szz += src->szz;
+    dst->sxz += src->sxz;
+    if (src->length_min < dst->length_min) dst->length_min = src->length_min;
+    if (src->length_max > dst->length_max) dst->length_max = src->length_max;
+    if (src->cost_min < dst->cost_min) dst->cost_min = src->cost_min;
+    if (src->cost_max > dst->cost_max) dst->cost_max = src->cost_max;
+    for (int i = 0; i <= CGA_MC_MAX_LENGTH; i++)
+        dst->length_hist[i] += src->length_hist[i];
+    for (int i = 0; i <= 2 * CGA_MC_MAX_LENGTH; i++)
+        dst->cost_hist[i] += src->cost_hist[i];
+}
+
+/**
+ * Next value of the splitmix64 sequence with state x.
+ */
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Seeds the generator of the given stream: the state is filled by splitmix64, started from the
+ * seed and the stream, as recommended for xoshiro.
+ */
+static void rng_seed(mc_rng_t *rng, uint64_t seed, uint64_t stream) {
+    uint64_t x = seed;
+    x ^= splitmix64(&stream);
+    for (int i = 0; i < 4; i++)
+        rng->s[i] = splitmix64(&x);
+}
+
+static inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * Next value of the xoshiro256** generator.
+ */
+static uint64_t rng_next(mc_rng_t *rng) {
+    uint64_t *s = rng->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+/**
+ * Uniform integer in [0, n), with Lemire's multiply and shift (the bias is below 2^-32).
+ */
+static uint32_t rng_below(mc_rng_t *rng, uint32_t n) {
+    return (uint32_t)(((rng_next(rng) >> 32) * (uint64_t)n) >> 32);
+}
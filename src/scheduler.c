@@ -0,0 +1,115 @@
+#include "scheduler.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef struct _sched_task {
+    uint32_t id;
+    uint64_t weight;
+} sched_task_t;
+
+/**
+ * Queue of a worker. The tasks in [head, tail) are still to be assigned, sorted by
+ * decreasing weight.
+ */
+typedef struct _sched_queue {
+    pthread_mutex_t lock;
+    uint32_t *tasks;
+    size_t head;
+    size_t tail;
+} sched_queue_t;
+
+struct _cga_sched {
+    unsigned int nworkers;
+    sched_queue_t *queues;
+};
+
+static int cmp_task(const void *a, const void *b);
+static int sched_pop(sched_queue_t *queue, uint32_t *task);
+
+cga_sched_t *cga_sched_init(unsigned int nworkers, const uint32_t *tasks, const uint64_t *weights, size_t ntasks) {
+    if (nworkers == 0) return NULL;
+    cga_sched_t *sched = malloc(sizeof(cga_sched_t));
+    if (sched == NULL)
+        return NULL;
+    sched->nworkers = nworkers;
+    sched->queues = calloc(nworkers, sizeof(sched_queue_t));
+    sched_task_t *sorted = malloc((ntasks ? ntasks : 1) * sizeof(sched_task_t));
+    if (sched->queues == NULL || sorted == NULL) {
+        free(sched->queues);
+        free(sorted);
+        free(sched);
+        return NULL;
+    }
+    for (size_t i = 0; i < ntasks; i++) {
+        sorted[i].id = tasks[i];
+        sorted[i].weight = (weights != NULL) ? weights[i] : 0;
+    }
+    if (weights != NULL)
+        qsort(sorted, ntasks, sizeof(sched_task_t), cmp_task);
+
+    for (unsigned int w = 0; w < nworkers; w++) {
+        size_t n = ntasks / nworkers + (w < ntasks % nworkers ? 1 : 0);
+        sched->queues[w].tasks = malloc((n ? n : 1) * sizeof(uint32_t));
+        if (sched->queues[w].tasks == NULL) {
+            for (unsigned int k = 0; k < w; k++) free(sched->queues[k].tasks);
+            free(sched->queues);
+            free(sorted);
+            free(sched);
+            return NULL;
+        }
+        pthread_mutex_init(&sched->queues[w].lock, NULL);
+    }
+    // deal the tasks round robin, so every queue is sorted by decreasing weight
+    for (size_t i = 0; i < ntasks; i++) {
+        sched_queue_t *queue = &sched->queues[i % nworkers];
+        queue->tasks[queue->tail++] = sorted[i].id;
+    }
+    free(sorted);
+    return sched;
+}
+
+void cga_sched_destroy(cga_sched_t *sched) {
+    for (unsigned int w = 0; w < sched->nworkers; w++) {
+        pthread_mutex_destroy(&sched->queues[w].lock);
+        free(sched->queues[w].tasks);
+    }
+    free(sched->queues);
+    free(sched);
+}
+
+int cga_sched_next(cga_sched_t *sched, unsigned int worker, uint32_t *task) {
+    if (sched_pop(&sched->queues[worker], task))
+        return 1;
+    for (unsigned int i = 1; i < sched->nworkers; i++) {  // steal from the other workers
+        if (sched_pop(&sched->queues[(worker + i) % sched->nworkers], task))
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * Takes the largest task left in the queue.
+ *
+ * Returns 1 if a task has been stored in task, 0 if the queue is empty
+ */
+static int sched_pop(sched_queue_t *queue, uint32_t *task) {
+    int found = 0;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->head < queue->tail) {
+        *task = queue->tasks[queue->head++];
+        found = 1;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+/**
+ * Comparison function used to sort the tasks by decreasing weight
+ */
+static int cmp_task(const void *a, const void *b) {
+    const sched_task_t *x = a, *y = b;
+    if (x->weight != y->weight)
+        return (x->weight < y->weight) - (x->weight > y->weight);
+    return (x->id > y->id) - (x->id < y->id);
+}
@@ -0,0 +1,177 @@
+#include "snapshot.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "graph.h"
+#include "stats.h"
+
+_Static_assert(sizeof(unsigned long) == sizeof(uint64_t), "labels are mapped as uint64_t");
+
+static cga_status_t snapshot_map(cga_graph_t *graph, const char *path);
+static int snapshot_valid(const cga_graph_t *graph);
+static uint64_t align8(uint64_t off);
+static int write_section(FILE *fp, const void *data, size_t size);
+static int cmp_index(const void *a, const void *b);
+
+cga_status_t cga_snapshot_save(const cga_graph_t *graph, const char *path) {
+    cga_snapshot_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CGA_SNAPSHOT_MAGIC, sizeof(CGA_SNAPSHOT_MAGIC));
+    header.version = CGA_SNAPSHOT_VERSION;
+    header.header_size = sizeof(header);
+    header.vcount = graph->vcount;
+    header.ecount = graph->ecount;
+    header.offsets_off = align8(sizeof(header));
+    header.adj_off = align8(header.offsets_off + ((uint64_t)graph->vcount + 1) * sizeof(uint32_t));
+    header.labels_off = align8(header.adj_off + (uint64_t)graph->ecount * sizeof(uint32_t));
+    header.index_off = align8(header.labels_off + (uint64_t)graph->vcount * sizeof(uint64_t));
+    header.file_size = header.index_off + (uint64_t)graph->vcount * sizeof(cga_asn_index_t);
+
+    cga_asn_index_t *index = malloc((graph->vcount ? graph->vcount : 1) * sizeof(cga_asn_index_t));
+    if (index == NULL)
+        return NOMEM;
+    for (uint32_t v = 0; v < graph->vcount; v++) {
+        index[v].asn = graph->labels[v];
+        index[v].id = v;
+        index[v].reserved = 0;
+    }
+    qsort(index, graph->vcount, sizeof(cga_asn_index_t), cmp_index);
+
+    int size = snprintf(NULL, 0, "%s.tmp", path);
+    char *tmp_path = malloc(size + 1);
+    if (tmp_path == NULL) {
+        free(index);
+        return NOMEM;
+    }
+    snprintf(tmp_path, size + 1, "%s.tmp", path);
+    FILE *fp = fopen(tmp_path, "wb");
+    if (fp == NULL) {
+        free(index);
+        free(tmp_path);
+        return NWPERM;
+    }
+    int ok = fwrite(&header, sizeof(header), 1, fp) == 1
+        && write_section(fp, graph->offsets, ((size_t)graph->vcount + 1) * sizeof(uint32_t))
+        && write_section(fp, graph->adj, (size_t)graph->ecount * sizeof(uint32_t))
+        && write_section(fp, graph->labels, (size_t)graph->vcount * sizeof(uint64_t))
+        && write_section(fp, index, (size_t)graph->vcount * sizeof(cga_asn_index_t));
+    ok = (fclose(fp) == 0) && ok;
+    ok = ok && rename(tmp_path, path) == 0;
+    if (!ok) remove(tmp_path);
+    free(index);
+    free(tmp_path);
+    return ok ? SUCCESS : NWPERM;
+}
+
+cga_status_t cga_snapshot_open(cga_graph_t *graph, const char *path) {
+    cga_stats_phase_begin(CGA_PHASE_LOAD);
+    cga_status_t status = snapshot_map(graph, path);
+    cga_stats_phase_end(CGA_PHASE_LOAD);
+    return status;
+}
+
+/**
+ * Maps the snapshot file path and points the arrays of the graph into it, see cga_snapshot_open.
+ */
+static cga_status_t snapshot_map(cga_graph_t *graph, const char *path) {
+    memset(graph, 0, sizeof(cga_graph_t));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NRPERM;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(cga_snapshot_header_t)) {
+        close(fd);
+        return WRFORMAT;
+    }
+    char *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  // the mapping keeps the file open
+    if (data == MAP_FAILED)
+        return NRPERM;
+
+    // check that the header describes sections fully contained in the file
+    const cga_snapshot_header_t *header = (const cga_snapshot_header_t *)data;
+    uint64_t n = header->vcount, m = header->ecount;
+    if (memcmp(header->magic, CGA_SNAPSHOT_MAGIC, sizeof(CGA_SNAPSHOT_MAGIC)) != 0
+        || header->version != CGA_SNAPSHOT_VERSION || header->header_size != sizeof(cga_snapshot_header_t)
+        || header->file_size != (uint64_t)st.st_size || n > CGA_GRAPH_MAX_VERTICES
+        || header->offsets_off % 8 || header->adj_off % 8 || header->labels_off % 8 || header->index_off % 8
+        || header->offsets_off < sizeof(cga_snapshot_header_t)
+        || header->offsets_off + (n + 1) * sizeof(uint32_t) > header->adj_off
+        || header->adj_off + m * sizeof(uint32_t) > header->labels_off
+        || header->labels_off + n * sizeof(uint64_t) > header->index_off
+        || header->index_off + n * sizeof(cga_asn_index_t) > header->file_size) {
+        munmap(data, st.st_size);
+        return WRFORMAT;
+    }
+    graph->vcount = header->vcount;
+    graph->ecount = header->ecount;
+    graph->offsets = (uint32_t *)(data + header->offsets_off);
+    graph->adj = (uint32_t *)(data + header->adj_off);
+    graph->labels = (unsigned long *)(data + header->labels_off);
+    graph->index = (cga_asn_index_t *)(data + header->index_off);
+    if (!snapshot_valid(graph)) {
+        memset(graph, 0, sizeof(cga_graph_t));
+        munmap(data, st.st_size);
+        return WRFORMAT;
+    }
+    graph->mapping = data;
+    graph->mapping_size = st.st_size;
+    return SUCCESS;
+}
+
+/**
+ * Checks in O(V + E) that the arrays of a mapped snapshot describe a graph the searches can walk
+ * without reading out of them: monotonic offsets from 0 to ecount, adjacency words holding a
+ * vertex id below vcount and a valid relationship, index entries pointing to vertices.
+ *
+ * Returns 1 if the graph is valid, 0 otherwise
+ */
+static int snapshot_valid(const cga_graph_t *graph) {
+    uint32_t n = graph->vcount;
+    if (graph->offsets[0] != 0 || graph->offsets[n] != graph->ecount)
+        return 0;
+    for (uint32_t v = 0; v < n; v++) {
+        if (graph->offsets[v] > graph->offsets[v + 1] || graph->index[v].id >= n)
+            return 0;
+    }
+    for (uint32_t e = 0; e < graph->ecount; e++) {
+        uint32_t w = graph->adj[e];
+        if (CGA_ADJ_VERTEX(w) >= n || CGA_ADJ_REL(w) > 1)
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * Rounds off up to a multiple of 8
+ */
+static uint64_t align8(uint64_t off) {
+    return (off + 7) & ~(uint64_t)7;
+}
+
+/**
+ * Writes the padding needed to align the current position to 8 bytes, then the data.
+ *
+ * Returns 1 if the operation completed without errors, 0 otherwise
+ */
+static int write_section(FILE *fp, const void *data, size_t size) {
+    static const char zeros[8] = {0};
+    long pos = ftell(fp);
+    if (pos < 0) return 0;
+    size_t padding = align8(pos) - pos;
+    if (padding > 0 && fwrite(zeros, 1, padding, fp) != padding) return 0;
+    return size == 0 || fwrite(data, 1, size, fp) == size;
+}
+
+/**
+ * Comparison function used to sort the as_number index
+ */
+static int cmp_index(const void *a, const void *b) {
+    const cga_asn_index_t *x = a, *y = b;
+    return (x->asn > y->asn) - (x->asn < y->asn);
+}
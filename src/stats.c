@@ -0,0 +1,263 @@
+#include "stats.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+__thread cga_stats_slot_t *cga_stats_tls = NULL;
+
+static const char *stat_names[CGA_STAT_COUNT] = {"sources", "pairs", "expanded", "pruned", "paths", "bytes"};
+static const char *phase_names[CGA_PHASE_COUNT] = {"load", "build", "analyze", "write"};
+
+/**
+ * State shared by all the threads: the list of the slots of the running threads, the counts of
+ * the ended ones and the phase timers, changed under lock (registrations, thread exits and phase
+ * changes are rare compared to the counting).
+ */
+static struct {
+    pthread_mutex_t lock;
+    cga_stats_slot_t *slots;
+    uint64_t retired[CGA_STAT_COUNT];  // counts of the slots of the ended threads
+    struct timespec start;
+    int started;
+    unsigned int active[CGA_PHASE_COUNT];  // threads in each phase
+    struct timespec since[CGA_PHASE_COUNT];  // start of the current interval of each active phase
+    double phases[CGA_PHASE_COUNT];
+} stats = {PTHREAD_MUTEX_INITIALIZER, NULL, {0}, {0, 0}, 0, {0}, {{0, 0}}, {0}};
+
+static pthread_key_t stats_key;  // the slot of each thread, to retire it when the thread ends
+static pthread_once_t stats_key_once = PTHREAD_ONCE_INIT;
+
+/**
+ * The reporter thread and its parameters.
+ */
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t t_id;
+    int running;
+    int stop;
+    double interval;
+    FILE *out;
+} reporter = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0, 0, NULL};
+
+static void stats_key_create(void);
+static void stats_retire(void *attr);
+static double seconds_since(const struct timespec *since, const struct timespec *now);
+static void ensure_started(void);
+static void *reporter_job(void *attr);
+static void report_line(FILE *out, const cga_stats_t *curr, const cga_stats_t *prev);
+
+cga_stats_slot_t *cga_stats_register(void) {
+    cga_stats_slot_t *slot;
+    if (posix_memalign((void **)&slot, 64, sizeof(cga_stats_slot_t)) != 0) {
+        fprintf(stderr, "%s", "Out of memory while allocating the statistics. Aborting process...");
+        abort();
+    }
+    for (int k = 0; k < CGA_STAT_COUNT; k++)
+        slot->counters[k] = 0;
+    pthread_once(&stats_key_once, stats_key_create);
+    pthread_mutex_lock(&stats.lock);
+    ensure_started();
+    slot->next = stats.slots;
+    stats.slots = slot;
+    pthread_mutex_unlock(&stats.lock);
+    pthread_setspecific(stats_key, slot);
+    cga_stats_tls = slot;
+    return slot;
+}
+
+void cga_stats_phase_begin(cga_phase_t phase) {
+    pthread_mutex_lock(&stats.lock);
+    ensure_started();
+    if (stats.active[phase]++ == 0)
+        clock_gettime(CLOCK_MONOTONIC, &stats.since[phase]);
+    pthread_mutex_unlock(&stats.lock);
+}
+
+void cga_stats_phase_end(cga_phase_t phase) {
+    pthread_mutex_lock(&stats.lock);
+    if (stats.active[phase] > 0 && --stats.active[phase] == 0) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        stats.phases[phase] += seconds_since(&stats.since[phase], &now);
+    }
+    pthread_mutex_unlock(&stats.lock);
+}
+
+void cga_stats_read(cga_stats_t *res) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pthread_mutex_lock(&stats.lock);
+    ensure_started();
+    for (int k = 0; k < CGA_STAT_COUNT; k++)
+        res->counters[k] = stats.retired[k];
+    for (cga_stats_slot_t *slot = stats.slots; slot != NULL; slot = slot->next) {
+        for (int k = 0; k < CGA_STAT_COUNT; k++)
+            res->counters[k] += __atomic_load_n(&slot->counters[k], __ATOMIC_RELAXED);
+    }
+    for (int p = 0; p < CGA_PHASE_COUNT; p++) {  // the active phases are counted up to now
+        res->phases[p] = stats.phases[p];
+        if (stats.active[p] > 0) res->phases[p] += seconds_since(&stats.since[p], &now);
+    }
+    res->elapsed = seconds_since(&stats.start, &now);
+    pthread_mutex_unlock(&stats.lock);
+}
+
+void cga_stats_reset(void) {
+    pthread_mutex_lock(&stats.lock);
+    for (cga_stats_slot_t *slot = stats.slots; slot != NULL; slot = slot->next) {
+        for (int k = 0; k < CGA_STAT_COUNT; k++)
+            __atomic_store_n(&slot->counters[k], 0, __ATOMIC_RELAXED);
+    }
+    for (int k = 0; k < CGA_STAT_COUNT; k++)
+        stats.retired[k] = 0;
+    clock_gettime(CLOCK_MONOTONIC, &stats.start);
+    stats.started = 1;
+    for (int p = 0; p < CGA_PHASE_COUNT; p++) {
+        stats.phases[p] = 0;
+        stats.since[p] = stats.start;  // an active phase is counted from now
+    }
+    pthread_mutex_unlock(&stats.lock);
+}
+
+const char *cga_stat_name(cga_stat_t stat) {
+    return (stat >= 0 && stat < CGA_STAT_COUNT) ? stat_names[stat] : "unknown";
+}
+
+const char *cga_phase_name(cga_phase_t phase) {
+    return (phase >= 0 && phase < CGA_PHASE_COUNT) ? phase_names[phase] : "unknown";
+}
+
+void cga_stats_print_json(const cga_stats_t *res, FILE *out) {
+    fprintf(out, "{\"elapsed\": %.6f, \"counters\": {", res->elapsed);
+    for (int k = 0; k < CGA_STAT_COUNT; k++)
+        fprintf(out, "%s\"%s\": %llu", k ? ", " : "", stat_names[k], (unsigned long long)res->counters[k]);
+    fprintf(out, "}, \"phases\": {");
+    for (int p = 0; p < CGA_PHASE_COUNT; p++)
+        fprintf(out, "%s\"%s\": %.6f", p ? ", " : "", phase_names[p], res->phases[p]);
+    fprintf(out, "}}\n");
+}
+
+cga_status_t cga_stats_reporter_start(double interval, FILE *out) {
+    pthread_mutex_lock(&reporter.lock);
+    if (reporter.running) {
+        pthread_mutex_unlock(&reporter.lock);
+        return DPLKTKEY;
+    }
+    reporter.interval = interval > 0 ? interval : 1;
+    reporter.out = out;
+    reporter.stop = 0;
+    if (pthread_create(&reporter.t_id, NULL, reporter_job, NULL) != 0) {
+        pthread_mutex_unlock(&reporter.lock);
+        return NOMEM;
+    }
+    reporter.running = 1;
+    pthread_mutex_unlock(&reporter.lock);
+    return SUCCESS;
+}
+
+void cga_stats_reporter_stop(void) {
+    pthread_mutex_lock(&reporter.lock);
+    if (!reporter.running) {
+        pthread_mutex_unlock(&reporter.lock);
+        return;
+    }
+    reporter.stop = 1;
+    pthread_cond_signal(&reporter.cond);
+    pthread_mutex_unlock(&reporter.lock);
+    pthread_join(reporter.t_id, NULL);
+    pthread_mutex_lock(&reporter.lock);
+    reporter.running = 0;
+    pthread_mutex_unlock(&reporter.lock);
+}
+
+/**
+ * Creates the key whose destructor retires the slot of a thread when it ends.
+ */
+static void stats_key_create(void) {
+    pthread_key_create(&stats_key, stats_retire);
+}
+
+/**
+ * Destructor of the slot of an ending thread: adds its counters to the retired ones, so they are
+ * not lost, then unlinks and frees it.
+ */
+static void stats_retire(void *attr) {
+    cga_stats_slot_t *slot = attr;
+    pthread_mutex_lock(&stats.lock);
+    for (int k = 0; k < CGA_STAT_COUNT; k++)
+        stats.retired[k] += slot->counters[k];
+    cga_stats_slot_t **prev = &stats.slots;
+    while (*prev != slot)
+        prev = &(*prev)->next;
+    *prev = slot->next;
+    pthread_mutex_unlock(&stats.lock);
+    if (cga_stats_tls == slot)
+        cga_stats_tls = NULL;
+    free(slot);
+}
+
+/**
+ * Seconds from since to now
+ */
+static double seconds_since(const struct timespec *since, const struct timespec *now) {
+    return (now->tv_sec - since->tv_sec) + (now->tv_nsec - since->tv_nsec) * 1e-9;
+}
+
+/**
+ * Starts the elapsed time at the first use of the statistics. Called with the lock held.
+ */
+static void ensure_started(void) {
+    if (!stats.started) {
+        clock_gettime(CLOCK_MONOTONIC, &stats.start);
+        stats.started = 1;
+    }
+}
+
+/**
+ * Reporter thread: writes a line every interval seconds, and a last one when it is stopped.
+ */
+static void *reporter_job(void *attr) {
+    (void)attr;
+    cga_stats_t prev, curr;
+    cga_stats_read(&prev);
+    pthread_mutex_lock(&reporter.lock);
+    while (!reporter.stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);  // the clock of the condition variable
+        double whole = (double)(long)reporter.interval;
+        deadline.tv_sec += (time_t)whole;
+        deadline.tv_nsec += (long)((reporter.interval - whole) * 1e9);
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        int res = 0;
+        while (!reporter.stop && res != ETIMEDOUT)
+            res = pthread_cond_timedwait(&reporter.cond, &reporter.lock, &deadline);
+        FILE *out = reporter.out;
+        pthread_mutex_unlock(&reporter.lock);
+        cga_stats_read(&curr);
+        report_line(out, &curr, &prev);
+        prev = curr;
+        pthread_mutex_lock(&reporter.lock);
+    }
+    pthread_mutex_unlock(&reporter.lock);
+    return NULL;
+}
+
+/**
+ * Writes a progress line: the counters and the pairs per second since prev.
+ */
+static void report_line(FILE *out, const cga_stats_t *curr, const cga_stats_t *prev) {
+    double dt = curr->elapsed - prev->elapsed;
+    double rate = dt > 0 ? (curr->counters[CGA_STAT_PAIRS] - prev->counters[CGA_STAT_PAIRS]) / dt : 0;
+    fprintf(out, "[%9.1fs] sources %llu, pairs %llu (%.0f/s), expanded %llu, pruned %llu, paths %llu, written %.1f MB\n",
+            curr->elapsed, (unsigned long long)curr->counters[CGA_STAT_SOURCES], (unsigned long long)curr->counters[CGA_STAT_PAIRS],
+            rate, (unsigned long long)curr->counters[CGA_STAT_EXPANDED], (unsigned long long)curr->counters[CGA_STAT_PRUNED],
+            (unsigned long long)curr->counters[CGA_STAT_PATHS], curr->counters[CGA_STAT_BYTES] / 1048576.0);
+    fflush(out);
+}
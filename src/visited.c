@@ -0,0 +1,27 @@
+#include "visited.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+cga_status_t cga_vs_init(cga_visited_t *vs, uint32_t size) {
+    vs->stamp = calloc(size ? size : 1, sizeof(uint32_t));
+    if (vs->stamp == NULL)
+        return NOMEM;
+    vs->epoch = 1;
+    vs->size = size;
+    return SUCCESS;
+}
+
+void cga_vs_destroy(cga_visited_t *vs) {
+    free(vs->stamp);
+    vs->stamp = NULL;
+    vs->size = 0;
+}
+
+void cga_vs_clear(cga_visited_t *vs) {
+    if (vs->epoch == UINT32_MAX) {  // the stamps would wrap around, start again from the first epoch
+        memset(vs->stamp, 0, (size_t)vs->size * sizeof(uint32_t));
+        vs->epoch = 0;
+    }
+    vs->epoch++;
+}
@@ -0,0 +1,213 @@
+#include "writer.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "stats.h"
+
+static const uint64_t pow10_table[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+// "00" "01" ... "99", to write the digits two at a time
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static inline void reserve(cga_writer_t *writer, size_t len);
+static char *format_uint(char *end, uint64_t value);
+
+cga_status_t cga_writer_open(cga_writer_t *writer, const char *path) {
+    writer->len = 0;
+    writer->size = CGA_WRITER_BUFSIZE;
+    writer->written = 0;
+    writer->status = SUCCESS;
+    writer->buf = malloc(writer->size);
+    if (writer->buf == NULL)
+        return NOMEM;
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (writer->fd < 0) {
+        free(writer->buf);
+        return NWPERM;
+    }
+    return SUCCESS;
+}
+
+cga_status_t cga_writer_resume(cga_writer_t *writer, const char *path, uint64_t offset) {
+    writer->len = 0;
+    writer->size = CGA_WRITER_BUFSIZE;
+    writer->written = offset;
+    writer->status = SUCCESS;
+    writer->buf = malloc(writer->size);
+    if (writer->buf == NULL)
+        return NOMEM;
+    writer->fd = open(path, O_WRONLY | O_CREAT, 0666);
+    if (writer->fd < 0) {
+        free(writer->buf);
+        return NWPERM;
+    }
+    struct stat st;
+    cga_status_t status = SUCCESS;
+    if (fstat(writer->fd, &st) != 0)
+        status = NWPERM;
+    else if ((uint64_t)st.st_size < offset)  // the file lost data the caller relies on
+        status = WRFORMAT;
+    else if (ftruncate(writer->fd, offset) != 0 || lseek(writer->fd, offset, SEEK_SET) < 0)
+        status = NWPERM;
+    if (status != SUCCESS) {
+        close(writer->fd);
+        free(writer->buf);
+    }
+    return status;
+}
+
+cga_status_t cga_writer_flush(cga_writer_t *writer) {
+    size_t done = 0;
+    if (writer->len > 0)
+        cga_stats_phase_begin(CGA_PHASE_WRITE);
+    while (done < writer->len && writer->status == SUCCESS) {
+        ssize_t n = write(writer->fd, writer->buf + done, writer->len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0)
+            writer->status = NWPERM;
+        else
+            done += n;
+    }
+    if (writer->len > 0) {
+        cga_stats_phase_end(CGA_PHASE_WRITE);
+        cga_stats_add(CGA_STAT_BYTES, done);
+    }
+    writer->written += done;
+    writer->len = 0;  // on errors the content is dropped, the status reports it
+    return writer->status;
+}
+
+cga_status_t cga_writer_sync(cga_writer_t *writer) {
+    if (cga_writer_flush(writer) == SUCCESS && fsync(writer->fd) != 0)
+        writer->status = NWPERM;
+    return writer->status;
+}
+
+cga_status_t cga_writer_close(cga_writer_t *writer) {
+    cga_writer_flush(writer);
+    if (close(writer->fd) != 0 && writer->status == SUCCESS)
+        writer->status = NWPERM;
+    free(writer->buf);
+    writer->buf = NULL;
+    return writer->status;
+}
+
+void cga_writer_write(cga_writer_t *writer, const char *data, size_t len) {
+    while (len > 0) {
+        if (writer->len == writer->size)
+            cga_writer_flush(writer);
+        size_t n = writer->size - writer->len < len ? writer->size - writer->len : len;
+        memcpy(writer->buf + writer->len, data, n);
+        writer->len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void cga_writer_puts(cga_writer_t *writer, const char *str) {
+    cga_writer_write(writer, str, strlen(str));
+}
+
+void cga_writer_uint(cga_writer_t *writer, uint64_t value) {
+    char tmp[24];
+    char *begin = format_uint(tmp + sizeof(tmp), value);
+    reserve(writer, CGA_WRITER_ROOM);
+    memcpy(writer->buf + writer->len, begin, tmp + sizeof(tmp) - begin);
+    writer->len += tmp + sizeof(tmp) - begin;
+}
+
+void cga_writer_int(cga_writer_t *writer, int64_t value) {
+    if (value < 0) {
+        cga_writer_putc(writer, '-');
+        cga_writer_uint(writer, -(uint64_t)value);  // also right for INT64_MIN
+    } else {
+        cga_writer_uint(writer, value);
+    }
+}
+
+void cga_writer_fixed(cga_writer_t *writer, double value, unsigned int decimals) {
+    if (decimals > 9) decimals = 9;
+    uint64_t scale = pow10_table[decimals];
+    if (signbit(value)) {  // printf keeps the sign of the negative values rounded to zero
+        cga_writer_putc(writer, '-');
+        value = -value;
+    }
+    if (!isfinite(value) || value >= 1e18) {  // out of the range of the integers, leave it to printf
+        char tmp[512];
+        int n = snprintf(tmp, sizeof(tmp), "%.*f", (int)decimals, value);
+        cga_writer_write(writer, tmp, n < (int)sizeof(tmp) ? n : sizeof(tmp) - 1);
+        return;
+    }
+    // the integral part and the fractional one are exact, and only the fractional one is scaled,
+    // so the product stays below 10^9 and keeps the bits of the decimals even for large values.
+    // It is rounded to nearest, ties to even, as printf does with the default rounding mode. The
+    // product can be rounded itself: only an exact tie is ambiguous, and the sign of the error of
+    // the product (computed exactly by fma) tells on which side of the tie the real value is
+    double integral = floor(value), fraction = value - integral;
+    uint64_t units = (uint64_t)integral;
+    double scaled = fraction * scale, digits = floor(scaled);
+    uint64_t rounded = (uint64_t)digits;
+    double frac = scaled - digits;
+    if (frac == 0.5) {
+        double err = fma(fraction, (double)scale, -scaled);
+        uint64_t last = decimals ? rounded : units;  // the last digit written
+        if (err > 0 || (err == 0 && (last & 1)))
+            rounded++;
+    } else if (frac > 0.5) {
+        rounded++;
+    }
+    if (rounded == scale) {  // the decimals carry into the units
+        units++;
+        rounded = 0;
+    }
+    cga_writer_uint(writer, units);
+    if (decimals == 0)
+        return;
+    char tmp[24];
+    char *end = tmp + sizeof(tmp), *begin = format_uint(end, rounded);
+    while (end - begin < (long)decimals)  // leading zeros of the decimals
+        *--begin = '0';
+    reserve(writer, CGA_WRITER_ROOM);
+    writer->buf[writer->len++] = '.';
+    memcpy(writer->buf + writer->len, begin, decimals);
+    writer->len += decimals;
+}
+
+/**
+ * Makes sure that the buffer has room for len more bytes, flushing it if needed.
+ */
+static inline void reserve(cga_writer_t *writer, size_t len) {
+    if (writer->size - writer->len < len)
+        cga_writer_flush(writer);
+}
+
+/**
+ * Formats value in base 10 in the characters right before end, two digits at a time.
+ *
+ * Returns a pointer to the first digit
+ */
+static char *format_uint(char *end, uint64_t value) {
+    char *p = end;
+    while (value >= 100) {
+        unsigned int pair = (value % 100) * 2;
+        value /= 100;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    }
+    if (value >= 10) {
+        *--p = digit_pairs[value * 2 + 1];
+        *--p = digit_pairs[value * 2];
+    } else {
+        *--p = '0' + value;
+    }
+    return p;
+}
@@ -0,0 +1,227 @@
+#include <igraph/igraph.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "cga.h"
+
+/**
+ * Checks the checkpoints of cga_graph_analysis_opts: a run interrupted after a checkpoint and
+ * resumed must write the same rows of an uninterrupted run, and a resume with different options,
+ * a different number of threads or the vertices in a different order must be rejected without
+ * touching the files of the run.
+ * The interruption is reproduced deterministically: a run takes a checkpoint after every
+ * target, then each manifest is cut back to the first half of its targets (with the offset of
+ * their rows in the output file) and a torn row is appended to the output file, which is the
+ * state left by a crash after that checkpoint.
+ * Usage: test_checkpoint <caida_snapshot> [output prefix]. The files are removed if the check
+ * passes.
+ */
+
+#define NTHREADS 2
+
+static char *path_of(const char *prefix, unsigned int worker, const char *ext);
+static void interrupt_worker(cga_graph_t *graph, const char *prefix, unsigned int worker);
+static char **read_rows(const char *prefix, unsigned int nfiles, size_t *nrows);
+static int cmp_rows(const void *a, const void *b);
+static long file_size(const char *path);
+static void fail(const char *msg);
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "%s", "Usage in cli: <caida_snapshot> [output prefix]\n");
+        exit(EXIT_FAILURE);
+    }
+    const char *prefix = argc > 2 ? argv[2] : "./output/test/checkpoint";
+    int size = snprintf(NULL, 0, "%s_ref", prefix);
+    char *ref = malloc(size + 1);
+    if (ref == NULL) fail("out of memory");
+    snprintf(ref, size + 1, "%s_ref", prefix);
+
+    cga_hashtable_t *ht = cga_ht_init(3000);
+    cga_graph_t graph;
+    FILE *fp = fopen(argv[1], "r");
+    if (fp == NULL) {
+        perror("fopen caida file");
+        exit(EXIT_FAILURE);
+    }
+    cga_load_snapshot(&graph, ht, fp);
+    fclose(fp);
+
+    cga_analysis_opts_t opts;
+    cga_analysis_opts_init(&opts);
+    if (cga_graph_analysis_opts(&graph, NTHREADS, ref, &opts) != SUCCESS)
+        fail("the uninterrupted run failed");
+
+    opts.checkpoint_interval = 1e-9;  // a checkpoint after every target
+    if (cga_graph_analysis_opts(&graph, NTHREADS, (char *)prefix, &opts) != SUCCESS)
+        fail("the run with checkpoints failed");
+    for (unsigned int i = 0; i < NTHREADS; i++)
+        interrupt_worker(&graph, prefix, i);
+
+    // the resumes of a different run are rejected and leave the files as they are
+    long sizes[NTHREADS];
+    for (unsigned int i = 0; i < NTHREADS; i++) {
+        char *csv = path_of(prefix, i, "csv");
+        sizes[i] = file_size(csv);
+        free(csv);
+    }
+    cga_analysis_opts_t other = opts;
+    other.resume = 1;
+    other.symmetric = 1;
+    if (cga_graph_analysis_opts(&graph, NTHREADS, (char *)prefix, &other) != WRFORMAT)
+        fail("a resume with different options has not been rejected");
+    other.symmetric = 0;
+    if (cga_graph_analysis_opts(&graph, NTHREADS + 1, (char *)prefix, &other) != WRFORMAT)
+        fail("a resume with a different number of threads has not been rejected");
+    // the same graph with the vertices in reverse order: the manifests hold the old vertex_ids
+    uint32_t vcount = cga_graph_vcount(&graph);
+    uint32_t *perm = malloc((vcount ? vcount : 1) * sizeof(uint32_t));
+    if (perm == NULL) fail("out of memory");
+    for (uint32_t v = 0; v < vcount; v++)
+        perm[v] = vcount - 1 - v;
+    if (cga_graph_permute(&graph, ht, perm) != SUCCESS) fail("the graph can't be reordered");
+    if (cga_graph_analysis_opts(&graph, NTHREADS, (char *)prefix, &other) != WRFORMAT)
+        fail("a resume after a reorder of the graph has not been rejected");
+    if (cga_graph_permute(&graph, ht, perm) != SUCCESS) fail("the graph can't be reordered");
+    free(perm);
+    for (unsigned int i = 0; i < NTHREADS; i++) {
+        char *csv = path_of(prefix, i, "csv");
+        if (file_size(csv) != sizes[i]) fail("a rejected resume has changed an output file");
+        free(csv);
+    }
+
+    opts.resume = 1;
+    if (cga_graph_analysis_opts(&graph, NTHREADS, (char *)prefix, &opts) != SUCCESS)
+        fail("the resume failed");
+
+    size_t nexpected, nrows;
+    char **expected = read_rows(ref, NTHREADS, &nexpected);
+    char **rows = read_rows(prefix, NTHREADS, &nrows);
+    if (nrows != nexpected)
+        fail("the resumed run has a different number of rows");
+    for (size_t k = 0; k < nrows; k++) {
+        if (strcmp(rows[k], expected[k]) != 0)
+            fail("the resumed run has different rows");
+    }
+    for (size_t k = 0; k < nrows; k++) {
+        free(rows[k]);
+        free(expected[k]);
+    }
+    free(rows);
+    free(expected);
+
+    for (unsigned int i = 0; i < NTHREADS; i++) {
+        char *files[3] = {path_of(ref, i, "csv"), path_of(prefix, i, "csv"), path_of(prefix, i, CGA_CHECKPOINT_EXT)};
+        for (int k = 0; k < 3; k++) {
+            remove(files[k]);
+            free(files[k]);
+        }
+    }
+    free(ref);
+    cga_graph_destroy(&graph);
+    cga_ht_destroy(ht);
+    printf("checkpoint: %zu rows, the resumed run matches the uninterrupted one\n", nrows);
+    return 0;
+}
+
+/**
+ * Returns prefix_worker.ext, to be freed with free()
+ */
+static char *path_of(const char *prefix, unsigned int worker, const char *ext) {
+    int size = snprintf(NULL, 0, "%s_%u.%s", prefix, worker, ext);
+    char *path = malloc(size + 1);
+    if (path == NULL) fail("out of memory");
+    snprintf(path, size + 1, "%s_%u.%s", prefix, worker, ext);
+    return path;
+}
+
+/**
+ * Turns the complete manifest and output file of a worker into the ones of a run that crashed
+ * after the checkpoint of the first half of its targets: the manifest keeps those targets and
+ * the size of the header and of their rows (the rows of a target are contiguous, and in the
+ * default mode they are the ones whose <to> is the target), and the output file gets a torn row.
+ */
+static void interrupt_worker(cga_graph_t *graph, const char *prefix, unsigned int worker) {
+    char *manifest = path_of(prefix, worker, CGA_CHECKPOINT_EXT);
+    char *csv = path_of(prefix, worker, "csv");
+    cga_checkpoint_header_t header;
+    uint32_t *done;
+    if (cga_checkpoint_load(manifest, &header, &done) != SUCCESS)
+        fail("the manifest of the run with checkpoints can't be read");
+    if (header.offset != (uint64_t)file_size(csv))
+        fail("the manifest of a complete run doesn't cover its output file");
+    uint64_t keep = header.ndone / 2;
+
+    FILE *fp = fopen(csv, "r+");
+    if (fp == NULL) fail("the output file can't be opened");
+    char line[1024];
+    if (fgets(line, sizeof(line), fp) == NULL) fail("the output file has no header");
+    uint64_t offset = strlen(line);
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        const char *comma = strchr(line, ',');
+        unsigned long to = comma != NULL ? strtoul(comma + 1, NULL, 10) : 0;
+        int kept = 0;
+        for (uint64_t k = 0; k < keep && !kept; k++)
+            kept = cga_graph_label(graph, done[k]) == to;
+        if (!kept) break;
+        offset += strlen(line);
+    }
+    fseek(fp, 0, SEEK_END);
+    fputs("4242,17", fp);  // a row cut by the crash
+    fclose(fp);
+
+    header.ndone = keep;
+    header.offset = offset;
+    if (cga_checkpoint_save(manifest, &header, done) != SUCCESS)
+        fail("the manifest can't be written");
+    free(done);
+    free(manifest);
+    free(csv);
+}
+
+/**
+ * Reads the rows (without the headers) of the files prefix_n.csv, n in [0, nfiles), and sorts them.
+ */
+static char **read_rows(const char *prefix, unsigned int nfiles, size_t *nrows) {
+    char **rows = NULL;
+    size_t size = 0;
+    *nrows = 0;
+    for (unsigned int i = 0; i < nfiles; i++) {
+        char *csv = path_of(prefix, i, "csv");
+        FILE *fp = fopen(csv, "r");
+        if (fp == NULL) fail("an output file can't be read");
+        char line[1024];
+        if (fgets(line, sizeof(line), fp) == NULL) fail("an output file has no header");
+        while (fgets(line, sizeof(line), fp) != NULL) {
+            if (*nrows == size) {
+                size = size ? 2 * size : 256;
+                char **temp = realloc(rows, size * sizeof(char *));
+                if (temp == NULL) fail("out of memory");
+                rows = temp;
+            }
+            if ((rows[(*nrows)++] = strdup(line)) == NULL) fail("out of memory");
+        }
+        fclose(fp);
+        free(csv);
+    }
+    qsort(rows, *nrows, sizeof(char *), cmp_rows);
+    return rows;
+}
+
+static int cmp_rows(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * Returns the size of a file, -1 if it doesn't exist
+ */
+static long file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+static void fail(const char *msg) {
+    fprintf(stderr, "checkpoint: %s\n", msg);
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,137 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "writer.h"
+
+/**
+ * Checks that cga_writer_fixed writes the same text of printf("%.*f"): the values are written
+ * one per line with a writer and compared with snprintf. The cases are the edge ones of the
+ * rounding (exact ties, values next to a tie, negative zero and negative values rounded to
+ * zero, the limit of the integer path, infinities and NaN) and many random values.
+ * Usage: test_writer_fixed [output file]. The file is removed if the check passes.
+ */
+
+#define RANDOM_VALUES 200000
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+static void add_value(double **values, unsigned int **decimals, size_t *n, size_t *size, double value, unsigned int d);
+static double random_value(void);
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "./output/test/writer_fixed.txt";
+    double *values = NULL;
+    unsigned int *decimals = NULL;
+    size_t n = 0, size = 0;
+
+    static const double edges[] = {
+        0.0, -0.0, 0.5, 1.5, 2.5, -0.5, -1.5, -2.5, 0.125, 0.375, -0.125, 0.0625, 2.675, 1.005,
+        1.0005, 0.0005, 0.0015, 0.0025, -0.0004, -0.0005, -1e-300, 1e-300, 5e-324, -5e-324,
+        0.9995, 0.99949999999999994, 9.9995, 99.995, 0.1, 0.2, 0.3, 1.0 / 3, 2.0 / 3,
+        123456789.0005, 4503599627370495.5, 4503599627370496.5, 9007199254740993.0, 1e17,
+        999999999999999.9, 1e18, 1e18 / 1000, 1e18 / 1000 - 0.5, -1e18 / 1000, 1e300, -1e300,
+        INFINITY, -INFINITY, NAN, -NAN};
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+        for (unsigned int d = 0; d <= 9; d++)
+            add_value(&values, &decimals, &n, &size, edges[i], d);
+    }
+    // the dyadic values k / 2^m are exact, so many of them are exact ties once scaled
+    for (unsigned int m = 1; m <= 12; m++) {
+        for (unsigned int k = 1; k < (1u << m) * 4; k += 2) {
+            for (unsigned int d = 0; d <= 9; d++) {
+                add_value(&values, &decimals, &n, &size, k / (double)(1u << m), d);
+                add_value(&values, &decimals, &n, &size, -(k / (double)(1u << m)), d);
+            }
+        }
+    }
+    // the neighbours of the ties, one ulp away on both sides
+    for (unsigned int d = 0; d <= 6; d++) {
+        double scale = pow(10, d);
+        for (unsigned int k = 0; k < 2000; k++) {
+            double tie = (k + 0.5) / scale;
+            add_value(&values, &decimals, &n, &size, tie, d);
+            add_value(&values, &decimals, &n, &size, nextafter(tie, 0), d);
+            add_value(&values, &decimals, &n, &size, nextafter(tie, INFINITY), d);
+        }
+    }
+    for (unsigned int i = 0; i < RANDOM_VALUES; i++)
+        add_value(&values, &decimals, &n, &size, random_value(), i % 10);
+
+    cga_writer_t writer;
+    if (cga_writer_open(&writer, path) != SUCCESS) {
+        fprintf(stderr, "Can't open %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < n; i++) {
+        cga_writer_fixed(&writer, values[i], decimals[i]);
+        cga_writer_putc(&writer, '\n');
+    }
+    if (cga_writer_close(&writer) != SUCCESS) {
+        fprintf(stderr, "Error while writing %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror("fopen writer output");
+        exit(EXIT_FAILURE);
+    }
+    char line[512], expected[512];
+    size_t mismatches = 0;
+    for (size_t i = 0; i < n; i++) {
+        snprintf(expected, sizeof(expected), "%.*f\n", (int)decimals[i], values[i]);
+        if (fgets(line, sizeof(line), fp) == NULL) {
+            fprintf(stderr, "The output ends after %zu of %zu values\n", i, n);
+            mismatches++;
+            break;
+        }
+        if (strcmp(line, expected) != 0 && mismatches++ < 10)
+            fprintf(stderr, "%a with %u decimals: cga_writer_fixed %.*s, printf %s", values[i], decimals[i], (int)strcspn(line, "\n"), line, expected);
+    }
+    fclose(fp);
+    free(values);
+    free(decimals);
+    if (mismatches > 0) {
+        fprintf(stderr, "cga_writer_fixed: %zu mismatches over %zu values\n", mismatches, n);
+        return EXIT_FAILURE;
+    }
+    remove(path);
+    printf("cga_writer_fixed: %zu values, same output of printf\n", n);
+    return 0;
+}
+
+/**
+ * Appends the value and its number of decimals to the arrays of the cases.
+ */
+static void add_value(double **values, unsigned int **decimals, size_t *n, size_t *size, double value, unsigned int d) {
+    if (*n == *size) {
+        *size = *size ? 2 * *size : 1024;
+        double *v = realloc(*values, *size * sizeof(double));
+        unsigned int *dec = realloc(*decimals, *size * sizeof(unsigned int));
+        if (v == NULL || dec == NULL) {
+            fprintf(stderr, "%s", "Out of memory while allocating the cases. Aborting process...");
+            abort();
+        }
+        *values = v;
+        *decimals = dec;
+    }
+    (*values)[*n] = value;
+    (*decimals)[*n] = d;
+    (*n)++;
+}
+
+/**
+ * A random value with a random sign and a magnitude between 1e-12 and 1e20, so the values
+ * on both sides of the limit of the integer path are covered.
+ */
+static double random_value(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    double mantissa = (rng_state >> 11) * 0x1.0p-53;
+    int exponent = (int)(rng_state % 33) - 12;
+    double value = mantissa * pow(10, exponent);
+    return (rng_state & (1ULL << 10)) ? -value : value;
+}